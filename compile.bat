@@ -1,3 +1,5 @@
 glslc.exe src/shader.vert -o src/vert.spv
 glslc.exe src/shader.frag -o src/frag.spv
+glslc.exe -mfmt=c src/shader.vert -o src/vert.spv.inc
+glslc.exe -mfmt=c src/shader.frag -o src/frag.spv.inc
 pause
\ No newline at end of file
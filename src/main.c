@@ -1,49 +1,283 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <SDL2/SDL.h>
 #include <SDL2/SDL_vulkan.h>
 
 #include "vrend.h"
+#include "vrend_pacer.h"
+#include "vrend_thread.h"
+#include "vrend_latency.h"
+
+// Targets cycled through with the P key, 0 is unlimited
+#define NUM_PACER_TARGETS 4
+static const double _pacer_targets[NUM_PACER_TARGETS] = { 60.0, 30.0, 144.0, FRAME_PACER_UNLIMITED };
+
+// Present modes cycled through with the M key
+#define NUM_PRESENT_MODES 4
+static const VkPresentModeKHR _present_modes[NUM_PRESENT_MODES] = {
+    VK_PRESENT_MODE_FIFO_KHR, VK_PRESENT_MODE_MAILBOX_KHR, VK_PRESENT_MODE_IMMEDIATE_KHR, VK_PRESENT_MODE_FIFO_RELAXED_KHR
+};
+static const char* _present_mode_names[NUM_PRESENT_MODES] = { "fifo", "mailbox", "immediate", "fifo_relaxed" };
 
 SDL_bool running;
+VkBool32 low_latency;
 
-double GetDeltaTime(Uint64 start, Uint64 finish);
+double ParseTargetRate(char* arg);
+VkPresentModeKHR ParsePresentMode(char* arg);
+void CyclePresentMode(void* data);
+void CyclePacerTarget(void* data);
+void ApplyInput(void* data);
+void SetLowLatency(void* data);
+void SetVisible(void* data);
+void SetRefreshRate(void* data);
+void Redraw(void* data);
+void TogglePause(void* data);
 
 int main(int argc, char** argv){
 
     running = SDL_TRUE;
+    low_latency = VK_FALSE;
+
+    double target_hz = 60.0;
+    uint32_t bench_frames = 0;
+    uint32_t bench_allocations = 0;
+    uint32_t bench_upload_mb = 0;
+    VkBool32 render_thread = VK_TRUE;
+    for(int i = 1; i < argc; i ++){
+        if(strcmp(argv[i], "--fps") == 0 && i + 1 < argc){
+            target_hz = ParseTargetRate(argv[++i]);
+        } else if(strcmp(argv[i], "--prerecord") == 0){
+            SET_VREND_PRERECORD(VK_TRUE);
+        } else if(strcmp(argv[i], "--grid") == 0 && i + 2 < argc){
+            uint32_t columns = (uint32_t)atoi(argv[++i]);
+            uint32_t rows = (uint32_t)atoi(argv[++i]);
+            SET_VREND_GRID(columns, rows);
+        } else if(strcmp(argv[i], "--record-threads") == 0 && i + 1 < argc){
+            SET_VREND_RECORD_THREADS((uint32_t)atoi(argv[++i]));
+        } else if(strcmp(argv[i], "--bench-record") == 0){
+            bench_frames = 1000;
+        } else if(strcmp(argv[i], "--bench-memory") == 0){
+            bench_allocations = 2000;
+        } else if(strcmp(argv[i], "--bench-upload") == 0 && i + 1 < argc){
+            bench_upload_mb = (uint32_t)atoi(argv[++i]);
+        } else if(strcmp(argv[i], "--async-present") == 0){
+            SET_VREND_ASYNC_PRESENT(VK_TRUE);
+        } else if(strcmp(argv[i], "--present-mode") == 0 && i + 1 < argc){
+            SET_VREND_PRESENT_MODE(ParsePresentMode(argv[++i]));
+        } else if(strcmp(argv[i], "--images") == 0 && i + 1 < argc){
+            SET_VREND_SWAP_CHAIN_IMAGES((uint32_t)atoi(argv[++i]));
+        } else if(strcmp(argv[i], "--low-latency") == 0){
+            low_latency = VK_TRUE;
+            SET_VREND_LOW_LATENCY(VK_TRUE);
+        } else if(strcmp(argv[i], "--on-demand") == 0){
+            SET_VREND_ON_DEMAND(VK_TRUE);
+        } else if(strcmp(argv[i], "--pipeline-cache") == 0 && i + 1 < argc){
+            SET_VREND_PIPELINE_CACHE_PATH(argv[++i]);
+        } else if(strcmp(argv[i], "--no-pipeline-cache") == 0){
+            SET_VREND_PIPELINE_CACHE_PATH(NULL);
+        } else if(strcmp(argv[i], "--shader-dir") == 0 && i + 1 < argc){
+            SET_VREND_SHADER_DIR(argv[++i]);
+        } else if(strcmp(argv[i], "--host-allocator") == 0){
+            SET_VREND_HOST_ALLOCATOR(VK_TRUE);
+        } else if(strcmp(argv[i], "--no-render-thread") == 0){
+            render_thread = VK_FALSE;
+        }
+    }
 
     INIT_VREND("Vulkan CA", 640, 480);
+    InitFramePacer(target_hz);
+
+    if(bench_frames > 0 || bench_allocations > 0 || bench_upload_mb > 0){
+        if(bench_frames > 0) BENCH_VREND_RECORDING(bench_frames);
+        if(bench_allocations > 0) BENCH_VREND_MEMORY(bench_allocations);
+        if(bench_upload_mb > 0) BENCH_VREND_UPLOAD(bench_upload_mb);
+        FREE_VREND();
+        return 0;
+    }
+
+    // With the render thread the main thread only sleeps on events and hands
+    // them over, so neither side ever waits on the other
+    if(render_thread){
+        StartRenderThread();
+    }
 
     SDL_Event event;
+    VkBool32 visible = VK_TRUE;
+    int refresh_hz = GET_VREND_REFRESH_RATE();
     while(running){
-        Uint64 start_time = SDL_GetPerformanceCounter();
-        while(SDL_PollEvent(&event)){
-            switch(event.type){
-                case SDL_QUIT:
-                    running = SDL_FALSE;
-                    break;
-                case SDL_KEYDOWN:
-                    switch(event.key.keysym.sym){
-                        case SDLK_ESCAPE:
-                            running = SDL_FALSE;
-                            break;
-                    }
+        if(render_thread){
+            if(!SDL_WaitEvent(&event)) continue;
+        } else if(!SDL_PollEvent(&event)){
+            if(!TickRenderer()){
+                SDL_WaitEventTimeout(NULL, IS_VREND_PAUSED() ? VREND_MEMORY_BUDGET_IDLE_MS : HEADLESS_STEP_MS);
             }
+            continue;
         }
 
-        DRAW_VREND();
+        // Timestamped when the main thread sees it, the renderer reports when it was presented
+        Uint64 input_time = SDL_GetPerformanceCounter();
 
-        Uint64 finish_time = SDL_GetPerformanceCounter();
-        while(GetDeltaTime(start_time, finish_time) < 16.667){
-            finish_time = SDL_GetPerformanceCounter();
+        switch(event.type){
+            case SDL_QUIT:
+                running = SDL_FALSE;
+                break;
+            case SDL_WINDOWEVENT:
+                switch(event.window.event){
+                    case SDL_WINDOWEVENT_MINIMIZED:
+                    case SDL_WINDOWEVENT_HIDDEN:
+                        visible = VK_FALSE;
+                        PushRenderCommand(SetVisible, &visible, sizeof(visible));
+                        break;
+                    case SDL_WINDOWEVENT_RESTORED:
+                    case SDL_WINDOWEVENT_MAXIMIZED:
+                    case SDL_WINDOWEVENT_SHOWN:
+                        visible = VK_TRUE;
+                        PushRenderCommand(SetVisible, &visible, sizeof(visible));
+                        break;
+                    case SDL_WINDOWEVENT_SIZE_CHANGED:
+                        // A surface that had no area is usable again
+                        if(event.window.data1 > 0 && event.window.data2 > 0){
+                            visible = VK_TRUE;
+                            PushRenderCommand(SetVisible, &visible, sizeof(visible));
+                        }
+                        break;
+                    case SDL_WINDOWEVENT_EXPOSED:
+                        PushRenderCommand(Redraw, NULL, 0);
+                        break;
+                    #if SDL_VERSION_ATLEAST(2, 0, 18)
+                    case SDL_WINDOWEVENT_DISPLAY_CHANGED:
+                    #endif
+                    case SDL_WINDOWEVENT_MOVED: {
+                        // SDL video calls stay on this thread, the renderer only sees
+                        // the result. Moves arrive per pixel, so only changes are sent.
+                        int queried_hz = QUERY_VREND_REFRESH_RATE();
+                        if(queried_hz != refresh_hz){
+                            refresh_hz = queried_hz;
+                            PushRenderCommand(SetRefreshRate, &refresh_hz, sizeof(refresh_hz));
+                        }
+                        break;
+                    }
+                }
+                break;
+            case SDL_MOUSEMOTION:
+            case SDL_MOUSEBUTTONDOWN:
+                PushRenderCommand(ApplyInput, &input_time, sizeof(input_time));
+                break;
+            case SDL_KEYDOWN:
+                PushRenderCommand(ApplyInput, &input_time, sizeof(input_time));
+                switch(event.key.keysym.sym){
+                    case SDLK_ESCAPE:
+                        running = SDL_FALSE;
+                        break;
+                    case SDLK_p:
+                        PushRenderCommand(CyclePacerTarget, NULL, 0);
+                        break;
+                    case SDLK_SPACE:
+                        PushRenderCommand(TogglePause, NULL, 0);
+                        break;
+                    case SDLK_m:
+                        PushRenderCommand(CyclePresentMode, NULL, 0);
+                        break;
+                    case SDLK_l:
+                        low_latency = !low_latency;
+                        PushRenderCommand(SetLowLatency, &low_latency, sizeof(low_latency));
+                        break;
+                }
         }
     }
 
+    StopRenderThread();
+    PrintFramePacerStats(STR_VK_PRESENT_MODE_KHR(GET_VREND_PRESENT_MODE()));
+    PrintLatencyStats(low_latency ? "low latency" : "default");
+    PRINT_VREND_STATS();
+
     FREE_VREND();
     return 0;
 }
 
-double GetDeltaTime(Uint64 start, Uint64 finish){
-    return (double)(finish - start) / SDL_GetPerformanceFrequency() * 1000;
+double ParseTargetRate(char* arg){
+    if(strcmp(arg, "unlimited") == 0){
+        return FRAME_PACER_UNLIMITED;
+    }
+    double target_hz = atof(arg);
+    if(target_hz <= 0.0){
+        fprintf(stderr, "ERROR: invalid frame rate %s\n", arg);
+        exit(EXIT_FAILURE);
+    }
+    return target_hz;
+}
+
+VkPresentModeKHR ParsePresentMode(char* arg){
+    for(uint32_t i = 0; i < NUM_PRESENT_MODES; i ++){
+        if(strcmp(arg, _present_mode_names[i]) == 0){
+            return _present_modes[i];
+        }
+    }
+    fprintf(stderr, "ERROR: invalid present mode %s, expected fifo, mailbox, immediate or fifo_relaxed\n", arg);
+    exit(EXIT_FAILURE);
+}
+
+// Reports frame time and latency of the mode being left so modes can be compared in one run
+void CyclePresentMode(void* data){
+    VkPresentModeKHR current = GET_VREND_PRESENT_MODE();
+    PrintFramePacerStats(STR_VK_PRESENT_MODE_KHR(current));
+    PrintLatencyStats(STR_VK_PRESENT_MODE_KHR(current));
+
+    uint32_t next = 0;
+    for(uint32_t i = 0; i < NUM_PRESENT_MODES; i ++){
+        if(_present_modes[i] == current){
+            next = (i + 1) % NUM_PRESENT_MODES;
+            break;
+        }
+    }
+    SET_VREND_PRESENT_MODE(_present_modes[next]);
+    ResetFramePacerStats();
+    ResetLatencyStats();
+}
+
+// Pacer state belongs to whichever thread draws, so this runs as a render command
+void CyclePacerTarget(void* data){
+
+    // Report the mode being left so modes can be compared in one run
+    PrintFramePacerStats(STR_VK_PRESENT_MODE_KHR(GET_VREND_PRESENT_MODE()));
+
+    double current = GetFramePacerTarget();
+    uint32_t next = 0;
+    for(uint32_t i = 0; i < NUM_PACER_TARGETS; i ++){
+        if(_pacer_targets[i] == current){
+            next = (i + 1) % NUM_PACER_TARGETS;
+            break;
+        }
+    }
+    SetFramePacerTarget(_pacer_targets[next]);
+    ResetFramePacerStats();
+}
+
+void ApplyInput(void* data){
+    MARK_VREND_INPUT(*(Uint64*)data);
+}
+
+// Reports the mode being left, like the pacer targets
+void SetLowLatency(void* data){
+    VkBool32 enable = *(VkBool32*)data;
+    PrintLatencyStats(enable ? "default" : "low latency");
+    ResetLatencyStats();
+    SET_VREND_LOW_LATENCY(enable);
+}
+
+void SetVisible(void* data){
+    SET_VREND_VISIBLE(*(VkBool32*)data);
+}
+
+void SetRefreshRate(void* data){
+    SET_VREND_REFRESH_RATE(*(int*)data);
+}
+
+void Redraw(void* data){
+    REQUEST_VREND_REDRAW();
+}
+
+void TogglePause(void* data){
+    PAUSE_VREND(!IS_VREND_PAUSED());
 }
@@ -2,7 +2,19 @@
 
 layout (location = 0) out vec3 outColor;
 
-const vec3 positions[3] = vec3[3](
+layout (set = 0, binding = 0) uniform FrameUniforms {
+    vec4 clearColor;
+    uvec4 grid;             // Columns, rows
+} frame;
+
+// Set from the pipeline description, so without a grid the branch below is compiled out
+layout (constant_id = 0) const bool GRID_ENABLED = false;
+
+// First triangle covers the screen and draws the background
+const vec3 positions[6] = vec3[6](
+    vec3(-1.0, -1.0, 0.0),
+    vec3(3.0, -1.0, 0.0),
+    vec3(-1.0, 3.0, 0.0),
     vec3(1.0, 1.0, 0.0),
     vec3(-1.0, 1.0, 0.0),
     vec3(0.0, -1.0, 0.0)
@@ -15,6 +27,20 @@ const vec3 colors[3] = vec3[3](
 );
 
 void main(){
-    gl_Position = vec4(positions[gl_VertexIndex], 1.0);
-    outColor = colors[gl_VertexIndex];
+    vec3 position = positions[gl_VertexIndex];
+
+    // With a grid every instance of the triangle is shrunk into its own cell
+    if(GRID_ENABLED && gl_VertexIndex >= 3){
+        vec2 size = 2.0 / vec2(frame.grid.xy);
+        uvec2 cell = uvec2(gl_InstanceIndex % frame.grid.x, gl_InstanceIndex / frame.grid.x);
+        vec2 origin = vec2(cell) * size - 1.0;
+        position.xy = origin + (position.xy * 0.5 + 0.5) * size;
+    }
+
+    gl_Position = vec4(position, 1.0);
+    if(gl_VertexIndex < 3){
+        outColor = frame.clearColor.rgb;
+    } else {
+        outColor = colors[gl_VertexIndex - 3];
+    }
 }
\ No newline at end of file
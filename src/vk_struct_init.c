@@ -60,6 +60,48 @@ VkSemaphoreCreateInfo GetSemaphoreCI(VkSemaphoreCreateFlags flags){
     return info;
 }
 
+VkSemaphoreTypeCreateInfo GetSemaphoreTypeCI(VkSemaphoreType type, uint64_t initial_value){
+    VkSemaphoreTypeCreateInfo info = {0};
+    info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+    info.pNext = NULL;
+    info.semaphoreType = type;
+    info.initialValue = initial_value;
+    return info;
+}
+
+VkTimelineSemaphoreSubmitInfo GetTimelineSemaphoreSI(
+            uint32_t wait_value_count,
+            uint64_t* wait_values,
+            uint32_t signal_value_count,
+            uint64_t* signal_values
+){
+    VkTimelineSemaphoreSubmitInfo info = {0};
+    info.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+    info.pNext = NULL;
+    info.waitSemaphoreValueCount = wait_value_count;
+    info.pWaitSemaphoreValues = wait_values;
+    info.signalSemaphoreValueCount = signal_value_count;
+    info.pSignalSemaphoreValues = signal_values;
+    return info;
+}
+
+VkCommandBufferInheritanceInfo GetCommandBufferII(
+            VkRenderPass render_pass,
+            uint32_t subpass,
+            VkFramebuffer framebuffer
+){
+    VkCommandBufferInheritanceInfo info = {0};
+    info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+    info.pNext = NULL;
+    info.renderPass = render_pass;
+    info.subpass = subpass;
+    info.framebuffer = framebuffer;
+    info.occlusionQueryEnable = VK_FALSE;
+    info.queryFlags = 0;
+    info.pipelineStatistics = 0;
+    return info;
+}
+
 VkCommandBufferBeginInfo GetCommandBufferBI(
             VkCommandBufferInheritanceInfo* inheritance_info,
             VkCommandBufferUsageFlags flags            
@@ -92,7 +134,25 @@ VkRenderPassBeginInfo GetRenderPassBI(
     return info;
 }
 
-VkPipelineShaderStageCreateInfo GetShaderStageCI(VkShaderStageFlagBits stage_flags, VkShaderModule module){
+VkSpecializationInfo GetSpecializationInfo(
+            uint32_t map_entry_count,
+            VkSpecializationMapEntry* map_entries,
+            size_t data_size,
+            void* data
+){
+    VkSpecializationInfo info = {0};
+    info.mapEntryCount = map_entry_count;
+    info.pMapEntries = map_entries;
+    info.dataSize = data_size;
+    info.pData = data;
+    return info;
+}
+
+VkPipelineShaderStageCreateInfo GetShaderStageCI(
+            VkShaderStageFlagBits stage_flags,
+            VkShaderModule module,
+            VkSpecializationInfo* specialization_info
+){
     VkPipelineShaderStageCreateInfo info = {0};
     info.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
     info.pNext = NULL;
@@ -100,7 +160,7 @@ VkPipelineShaderStageCreateInfo GetShaderStageCI(VkShaderStageFlagBits stage_fla
     info.stage = stage_flags;
     info.module = module;
     info.pName = "main";
-    info.pSpecializationInfo = NULL;
+    info.pSpecializationInfo = specialization_info;
     return info;
 }
 
@@ -169,14 +229,80 @@ VkPipelineColorBlendAttachmentState GetColorBlendAttachmentState(){
     return attachment;
 }
 
-VkPipelineLayoutCreateInfo GetPipelineLayoutCI(){
+VkPipelineLayoutCreateInfo GetPipelineLayoutCI(uint32_t set_layout_count, VkDescriptorSetLayout* set_layouts){
     VkPipelineLayoutCreateInfo info = {0};
     info.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
     info.pNext = NULL;
     info.flags = 0;
-    info.setLayoutCount = 0;
-    info.pSetLayouts = NULL;
+    info.setLayoutCount = set_layout_count;
+    info.pSetLayouts = set_layouts;
     info.pushConstantRangeCount = 0;
     info.pPushConstantRanges = NULL;
     return info;
 }
+
+VkBufferCreateInfo GetBufferCI(VkDeviceSize size, VkBufferUsageFlags usage){
+    VkBufferCreateInfo info = {0};
+    info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    info.pNext = NULL;
+    info.flags = 0;
+    info.size = size;
+    info.usage = usage;
+    info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    info.queueFamilyIndexCount = 0;
+    info.pQueueFamilyIndices = NULL;
+    return info;
+}
+
+VkDescriptorSetLayoutCreateInfo GetDescriptorSetLayoutCI(uint32_t binding_count, VkDescriptorSetLayoutBinding* bindings){
+    VkDescriptorSetLayoutCreateInfo info = {0};
+    info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    info.pNext = NULL;
+    info.flags = 0;
+    info.bindingCount = binding_count;
+    info.pBindings = bindings;
+    return info;
+}
+
+VkDescriptorPoolCreateInfo GetDescriptorPoolCI(
+            uint32_t max_sets,
+            uint32_t pool_size_count,
+            VkDescriptorPoolSize* pool_sizes
+){
+    VkDescriptorPoolCreateInfo info = {0};
+    info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    info.pNext = NULL;
+    info.flags = 0;
+    info.maxSets = max_sets;
+    info.poolSizeCount = pool_size_count;
+    info.pPoolSizes = pool_sizes;
+    return info;
+}
+
+VkDescriptorSetAllocateInfo GetDescriptorSetAI(
+            VkDescriptorPool descriptor_pool,
+            uint32_t count,
+            VkDescriptorSetLayout* set_layouts
+){
+    VkDescriptorSetAllocateInfo info = {0};
+    info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    info.pNext = NULL;
+    info.descriptorPool = descriptor_pool;
+    info.descriptorSetCount = count;
+    info.pSetLayouts = set_layouts;
+    return info;
+}
+
+VkQueryPoolCreateInfo GetQueryPoolCI(
+            VkQueryType query_type,
+            uint32_t query_count
+){
+    VkQueryPoolCreateInfo info = {0};
+    info.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+    info.pNext = NULL;
+    info.flags = 0;
+    info.queryType = query_type;
+    info.queryCount = query_count;
+    info.pipelineStatistics = 0;
+    return info;
+}
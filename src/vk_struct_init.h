@@ -33,6 +33,24 @@ VkSemaphoreCreateInfo GetSemaphoreCI(
     VkSemaphoreCreateFlags flags
 );
 
+VkSemaphoreTypeCreateInfo GetSemaphoreTypeCI(
+    VkSemaphoreType type,
+    uint64_t initial_value
+);
+
+VkTimelineSemaphoreSubmitInfo GetTimelineSemaphoreSI(
+    uint32_t wait_value_count,
+    uint64_t* wait_values,
+    uint32_t signal_value_count,
+    uint64_t* signal_values
+);
+
+VkCommandBufferInheritanceInfo GetCommandBufferII(
+    VkRenderPass render_pass,
+    uint32_t subpass,
+    VkFramebuffer framebuffer
+);
+
 VkCommandBufferBeginInfo GetCommandBufferBI(
     VkCommandBufferInheritanceInfo* inheritance_info,
     VkCommandBufferUsageFlags flags            
@@ -47,9 +65,17 @@ VkRenderPassBeginInfo GetRenderPassBI(
     VkClearValue* clear_values
 );
 
+VkSpecializationInfo GetSpecializationInfo(
+    uint32_t map_entry_count,
+    VkSpecializationMapEntry* map_entries,
+    size_t data_size,
+    void* data
+);
+
 VkPipelineShaderStageCreateInfo GetShaderStageCI(
     VkShaderStageFlagBits flags,
-    VkShaderModule module
+    VkShaderModule module,
+    VkSpecializationInfo* specialization_info
 );
 
 VkPipelineVertexInputStateCreateInfo GetVertexInputCI();
@@ -66,6 +92,36 @@ VkPipelineMultisampleStateCreateInfo GetMultisampleCI();
 
 VkPipelineColorBlendAttachmentState GetColorBlendAttachmentState();
 
-VkPipelineLayoutCreateInfo GetPipelineLayoutCI();
+VkPipelineLayoutCreateInfo GetPipelineLayoutCI(
+    uint32_t set_layout_count,
+    VkDescriptorSetLayout* set_layouts
+);
+
+VkBufferCreateInfo GetBufferCI(
+    VkDeviceSize size,
+    VkBufferUsageFlags usage
+);
+
+VkDescriptorSetLayoutCreateInfo GetDescriptorSetLayoutCI(
+    uint32_t binding_count,
+    VkDescriptorSetLayoutBinding* bindings
+);
+
+VkDescriptorPoolCreateInfo GetDescriptorPoolCI(
+    uint32_t max_sets,
+    uint32_t pool_size_count,
+    VkDescriptorPoolSize* pool_sizes
+);
+
+VkDescriptorSetAllocateInfo GetDescriptorSetAI(
+    VkDescriptorPool descriptor_pool,
+    uint32_t count,
+    VkDescriptorSetLayout* set_layouts
+);
+
+VkQueryPoolCreateInfo GetQueryPoolCI(
+    VkQueryType query_type,
+    uint32_t query_count
+);
 
 #endif
@@ -1,15 +1,37 @@
 #include "vrend.h"
+#include "vrend_timeline.h"
+#include "vrend_jobs.h"
+#include "vrend_thread.h"
+#include "vrend_present.h"
+#include "vrend_latency.h"
+#include "vrend_deletion.h"
+#include "vrend_memory.h"
+#include "vrend_upload_ring.h"
+#include "vrend_transfer.h"
+#include "vrend_pipeline_cache.h"
+#include "vrend_pipeline_registry.h"
+#include "vrend_shader_cache.h"
+#include "vrend_shaders.h"
+#include "vrend_shader_watch.h"
+#include "vrend_host_alloc.h"
+#include "vrend_arena.h"
 
 struct PhysicalDeviceInfo {
     VkPhysicalDevice                        handle;
 
     uint32_t                                graphics_queue_index;
     uint32_t                                present_queue_index;
-    uint32_t                                num_queues;
+    uint32_t                                transfer_queue_index;   // Graphics family when there is no transfer only one
+    VkExtent3D                              transfer_granularity;   // minImageTransferGranularity of the transfer family
+    uint32_t                                num_queues;             // Distinct graphics and present families
+    uint32_t                                graphics_queue_count;   // Queues available in the graphics family
+    uint32_t                                timestamp_valid_bits;   // Of the graphics family, 0 without timestamps
+    VkBool32                                memory_budget;          // VK_EXT_memory_budget is supported
 
     VkPhysicalDeviceProperties              properties;
     VkPhysicalDeviceMemoryProperties        mem_properties;
     VkPhysicalDeviceFeatures                features;
+    VkPhysicalDeviceVulkan12Features        features12;
     VkSurfaceCapabilitiesKHR                capabilities;
     VkPhysicalDeviceLimits                  limits;
 
@@ -22,51 +44,193 @@ struct PhysicalDeviceInfo {
 struct SwapChainInfo {
     VkSwapchainKHR                          handle;
     VkFormat                                format;
+    VkPresentModeKHR                        present_mode;
     uint32_t                                num_images;
-    VkImage*                                images;
-    VkImageView*                            image_views;
-    VkFramebuffer*                          framebuffers;
+    VkImage                                 images[MAX_SWAP_CHAIN_IMAGES];
+    VkImageView                             image_views[MAX_SWAP_CHAIN_IMAGES];
+    VkFramebuffer                           framebuffers[MAX_SWAP_CHAIN_IMAGES];
+    uint64_t                                images_in_flight[MAX_SWAP_CHAIN_IMAGES];   // Graphics timeline value of the last frame using each image
+
+    // Pre-recorded mode, one command buffer per framebuffer
+    VkCommandBuffer                         command_buffers[MAX_SWAP_CHAIN_IMAGES];
+    VkBool32                                dirty[MAX_SWAP_CHAIN_IMAGES];   // Command buffer must be recorded again before use
+
+    // One upload partition per image, filled only once the image is not in
+    // flight. FrameUniforms is the first allocation of every partition.
+    struct UploadRing                       upload_ring;
+    VkDescriptorPool                        descriptor_pool;
+    VkDescriptorSet                         descriptor_sets[MAX_SWAP_CHAIN_IMAGES];
+
+    // Two timestamps per image bracket the GPU work of its last frame
+    VkQueryPool                             timestamp_pool;
+    VkBool32                                timestamps_pending[MAX_SWAP_CHAIN_IMAGES];   // Written by a submitted frame, not read back yet
 };
 
+// Must match FrameUniforms in shader.vert
+struct FrameUniforms {
+    float                                   clear_color[4];
+    uint32_t                                grid[4];                // Columns, rows
+};
+
+// A range of draws recorded into one secondary command buffer
+struct RecordTask {
+    struct FrameData*                       frame;
+    uint32_t                                image_index;
+    uint32_t                                first_draw;
+    uint32_t                                num_draws;
+    VkBool32                                background;
+    VkCommandBuffer                         command_buffer;         // Filled in by the recording thread
+};
+
+// Secondary command buffers recorded by one thread for one frame in flight.
+// The pool is reset as a whole once the frame has completed.
+struct WorkerCommands {
+    VkCommandPool                           pool;
+    uint32_t                                num_used;
+    uint32_t                                num_allocated;
+    VkCommandBuffer                         buffers[MAX_RECORD_TASKS];
+};
+
+// Per frame in flight resources. Frame i records into its own command buffer
+// and only waits for the GPU to finish frame i - num_frames_in_flight.
+struct FrameData {
+    VkCommandBuffer                         command_buffer;
+    struct WorkerCommands                   workers[MAX_JOB_WORKERS + MAX_JOB_CALLERS];   // Then one per thread recording outside the pool
+    VkSemaphore                             present_semaphore;
+    VkSemaphore                             render_semaphore;
+    uint64_t                                timeline_value;         // Graphics timeline value of the last submission
+    uint64_t                                present_id;             // Last request handed to the present thread
+};
+
+// Slack kept between the predicted end of GPU work and the next vblank in low latency mode
+#define LOW_LATENCY_MARGIN_MS 1.0
+
+// Shaders the pipeline is built from, in the order they are watched for hot reload
+#define NUM_PIPELINE_SHADERS 2
+static const char* _shader_names[NUM_PIPELINE_SHADERS] = { "vert", "frag" };
+static const char* _shader_sources[NUM_PIPELINE_SHADERS] = { "shader.vert", "shader.frag" };
+static const char* _shader_outputs[NUM_PIPELINE_SHADERS] = { "vert.spv", "frag.spv" };
+
+// Swap chains replaced before a frame was submitted on their successor
+#define MAX_RETIRED_SWAP_CHAINS 4
+
 #define NUM_REQUIRED_PHYSICAL_DEVICE_EXTENSIONS 1
 static const char* _required_physical_device_extensions[NUM_REQUIRED_PHYSICAL_DEVICE_EXTENSIONS] = {
     VK_KHR_SWAPCHAIN_EXTENSION_NAME
 };
 
+// constant_id values used in shader.vert
+#define SPEC_GRID_ENABLED 0
+
 static uint32_t                         _frame_counter = 0;
 static VkExtent2D                       _window_extent = {0};
 static SDL_Window*                      _window = NULL;
+static int                              _refresh_rate = 0;          // Cached on the main thread, 0 if unknown
 static VkInstance                       _instance = NULL;
 static VkSurfaceKHR                     _surface = NULL;
 static struct PhysicalDeviceInfo        _physical_device = {0};
 static VkDevice                         _device = NULL;
 static VkQueue                          _graphics_queue = NULL;
 static VkQueue                          _present_queue = NULL;
+static struct QueueTimeline             _graphics_timeline = {0};
+static VkQueue                          _transfer_queue = NULL;     // NULL without a transfer only family
+static struct QueueTimeline             _transfer_timeline = {0};
 static VkCommandPool                    _command_pool = NULL;
-static VkSemaphore                      _present_semaphore = NULL;
-static VkSemaphore                      _render_semaphore = NULL;
-static VkFence                          _render_fence = NULL;
+static uint32_t                         _num_frames_in_flight = DEFAULT_FRAMES_IN_FLIGHT;
+static uint32_t                         _requested_frames_in_flight = 0;    // Applied by the next frame, 0 when unchanged
+static struct FrameData                 _frames[MAX_FRAMES_IN_FLIGHT] = {0};
+static VkDescriptorSetLayout            _frame_set_layout = NULL;
+static VkBool32                         _prerecord = VK_FALSE;
+static VkBool32                         _async_present = VK_FALSE;
+static VkBool32                         _low_latency = VK_FALSE;
+static VkPresentModeKHR                 _requested_present_mode = VREND_PRESENT_MODE_AUTO;
+static uint32_t                         _requested_num_images = 0;  // 0 picks minImageCount + 1
+static VkBool32                         _swap_chain_stale = VK_FALSE;   // Recreated by the next frame
+static VkBool32                         _gpu_timestamps = VK_FALSE;
+static Uint64                           _pending_input_time = 0;    // Oldest input not shown by any frame yet
+static Uint64                           _vblank_estimate = 0;       // Predicted time the display takes the next image
+static double                           _sim_time = 0.0;            // Seconds of simulation, advanced by STEP_VREND
+static VkBool32                         _paused = VK_FALSE;
+static VkBool32                         _visible = VK_TRUE;
+static VkBool32                         _zero_extent = VK_FALSE;    // Surface has no area, e.g. minimized on some platforms
+static VkBool32                         _on_demand = VK_FALSE;
+static VkBool32                         _redraw_requested = VK_TRUE;
+static struct VrendRecordStats          _record_stats = {0};
+static uint32_t                         _record_threads = 0;
+static uint32_t                         _grid_columns = 0;
+static uint32_t                         _grid_rows = 0;
 
 // Needs to be remade on swap chain creation
 static struct SwapChainInfo             _swap_chain = {0};
-static VkCommandBuffer                  _command_buffer = NULL;
+static VkSwapchainKHR                   _retired_swap_chains[MAX_RETIRED_SWAP_CHAINS] = {0};   // Deleted with the next frame submit
+static uint32_t                         _num_retired_swap_chains = 0;
 static VkRenderPass                     _render_pass = NULL;
 static VkPipelineLayout                 _pipeline_layout = NULL;
 static VkPipeline                       _pipeline = NULL;
+static struct PipelineDescription       _pipeline_description = {0};    // _pipeline is NULL while it compiles
+static VkPipelineCache                  _pipeline_cache = NULL;
+static const char*                      _pipeline_cache_path = DEFAULT_PIPELINE_CACHE_PATH;
+static Uint64                           _init_start = 0;
+static const char*                      _shader_dir = NULL;         // Overrides the embedded shaders
+static VkBool32                         _host_allocator = VK_FALSE;
+static uint64_t                         _host_allocations_at_init = 0;
+static struct Arena                     _frame_arena = {0};         // Reset at the start of every frame
+static struct Arena                     _init_arena = {0};          // Lives until FREE_VREND
+static uint64_t                         _arena_block_allocations = 0;   // At the last frame boundary
+static uint64_t                         _arena_frames = 0;          // Frames that had to grow an arena
+static uint32_t                         _last_arena_frame = 0;      // Last of those frames
+static VkShaderModule                   _reload_shaders[NUM_PIPELINE_SHADERS] = {0};    // Waiting for their pipeline
+static VkBool32                         _reload_pending = VK_FALSE;
+static Uint64                           _reload_saved_time = 0;     // First change of the reload was seen
+static VkBool32                         _reload_swapped = VK_FALSE; // Latency is taken when the first frame is submitted
+static struct VrendMemoryUsage          _memory_usage = {0};        // As of the last budget query
+static VrendMemoryPressureCallback      _memory_callback = NULL;    // NULL applies _ApplyMemoryPolicy
+static void*                            _memory_callback_data = NULL;
+static Uint64                           _memory_budget_time = 0;    // Of the last budget query
+static VkBool32                         _pressure_min_images = VK_FALSE;    // CRITICAL, the swap chain takes as few images as allowed
 
 VkBool32 _CheckInstanceExtensions();
 void _SetPhysicalDevice(VkPhysicalDevice device);
 void _CreateSwapChain();
+void _FreeSwapChainImages();
+void _RetireObject(struct Deletion deletion);
+void _RetireSwapChains(uint64_t timeline_value);
 void _CreateCommandBuffers();
+void _CreateSyncStructures();
+void _FreeFrames();
+void _ResizeFrames(uint32_t count);
 void _CreateRenderPass();
-void _LoadShaderModule(char* path, VkShaderModule* module);
 void _CreateGraphicsPipeline();
+VkShaderModule _GetShader(const char* name);
+void _GetShaderPath(const char* name, char* path, size_t size);
+void _UpdateShaderReload();
+void _RetireReplacedShaders();
+VkBool32 _UpdatePipeline(VkBool32 wait);
 void _CreateFramebuffers();
-void CHECK(VkResult result, char* fname, VkBool32 print);
+void _CreateFrameUniforms();
+void _FreeFrameUniforms();
+void _CreateImageCommandBuffers();
+void _FreeImageCommandBuffers();
+void _RecordFrame(VkCommandBuffer command_buffer, uint32_t image_index, VkCommandBufferUsageFlags flags, struct FrameData* frame);
+void _RecordSecondaries(VkCommandBuffer command_buffer, uint32_t image_index, struct FrameData* frame);
+void _RecordTaskJob(void* data, uint32_t worker_index);
+void _RecordDraws(VkCommandBuffer command_buffer, uint32_t image_index, uint32_t first_draw, uint32_t num_draws, VkBool32 background);
+void _ResetWorkerCommands(struct FrameData* frame);
+void _StartPresentThread();
+void _UpdatePresentStats(Uint64 start);
+void _CreateTimestampQueries();
+void _FreeTimestampQueries();
+void _ReadGpuTime(uint32_t image_index);
+void _DelayFrameStart(Uint64 acquire_start, Uint64 acquire_end);
+uint32_t _GetNumDraws();
+void _UpdateMemoryBudget();
+void _ApplyMemoryPolicy(const struct VrendMemoryUsage* usage);
 void _PrintVulkanFunctionName(char* fname);
 
 void INIT_VREND(char* title, uint32_t w, uint32_t h){
 
+    _init_start = SDL_GetPerformanceCounter();
+
     {   // Initialize SDL2 window with Vulkan flag
         SDL_Init(SDL_INIT_EVERYTHING);
         SDL_WindowFlags flags = SDL_WINDOW_SHOWN | SDL_WINDOW_VULKAN | SDL_WINDOW_RESIZABLE;
@@ -78,9 +242,20 @@ void INIT_VREND(char* title, uint32_t w, uint32_t h){
             fprintf(stderr, "ERROR: failed to create SDL2 window\n");
             exit(EXIT_FAILURE);
         }
+        _refresh_rate = QUERY_VREND_REFRESH_RATE();
     }
 
+    {   // Host allocation callbacks, before anything is created with them
+        if(_host_allocator){
+            InitHostAllocator();
+        }
+    }
 
+    {   // Host memory arenas. Init time transients go to the frame arena
+        // and are released by the first frame.
+        InitArena(&_frame_arena, DEFAULT_ARENA_BLOCK_SIZE);
+        InitArena(&_init_arena, DEFAULT_ARENA_BLOCK_SIZE);
+    }
 
     {   // Check layers and extensions for instance
         #ifdef DEBUG
@@ -109,11 +284,11 @@ void INIT_VREND(char* title, uint32_t w, uint32_t h){
 
         uint32_t num_instance_extensions = 0;
         SDL_Vulkan_GetInstanceExtensions(_window, &num_instance_extensions, NULL);
-        const char** instance_extensions = malloc(sizeof(char*) * num_instance_extensions);
+        // One spare slot for debug utils
+        const char** instance_extensions = ArenaAlloc(&_frame_arena, sizeof(char*) * (num_instance_extensions + 1));
         SDL_Vulkan_GetInstanceExtensions(_window, &num_instance_extensions, instance_extensions);
         #ifdef DEBUG
             num_instance_extensions += 1;
-            instance_extensions = realloc(instance_extensions, sizeof(char*) * num_instance_extensions);
             instance_extensions[num_instance_extensions - 1] = VK_EXT_DEBUG_UTILS_EXTENSION_NAME;
         #endif
 
@@ -130,9 +305,7 @@ void INIT_VREND(char* title, uint32_t w, uint32_t h){
             instance_ci.pNext = NULL;
         #endif
 
-        VK_CHECK(vkCreateInstance, &instance_ci, NULL, &_instance);
-
-        free(instance_extensions);
+        VK_CHECK(vkCreateInstance, &instance_ci, GetHostAllocator(), &_instance);
     }
 
 
@@ -165,7 +338,7 @@ void INIT_VREND(char* title, uint32_t w, uint32_t h){
             fprintf(stderr, "ERROR: failed to find a device with Vulkan support\n");
             exit(EXIT_FAILURE);
         }
-        VkPhysicalDevice* physical_devices = malloc(sizeof(VkPhysicalDevice) * num_physical_devices);
+        VkPhysicalDevice* physical_devices = ArenaAlloc(&_frame_arena, sizeof(VkPhysicalDevice) * num_physical_devices);
         vkEnumeratePhysicalDevices(_instance, &num_physical_devices, physical_devices);
         // for(uint32_t i = 0; i < num_physical_devices; i ++){
         //     if(physical_devices[i] != NULL){
@@ -198,8 +371,6 @@ void INIT_VREND(char* title, uint32_t w, uint32_t h){
             }
         }
 
-        free(physical_devices);
-
         #ifdef DEBUG
             // printf("PHYSICAL DEVICE SELECTION SUCCESSFUL\n{\n");
             // printf("\tDevice: %s\n", _physical_device.properties.deviceName);
@@ -260,35 +431,102 @@ void INIT_VREND(char* title, uint32_t w, uint32_t h){
 
 
     {   // Create logical device and get device queues
-        float queue_priority = 1.0f;
-        VkDeviceQueueCreateInfo* queues_create_ci = malloc(sizeof(VkDeviceQueueCreateInfo) * _physical_device.num_queues);
-        for(uint32_t i = 0; i < _physical_device.num_queues; i ++){
+        float queue_priorities[2] = { 1.0f, 1.0f };
+        VkDeviceQueueCreateInfo queues_create_ci[3] = {0};
+        for(uint32_t i = 0; i < 3; i ++){
             queues_create_ci[i].sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
             queues_create_ci[i].queueCount = 1;
-            queues_create_ci[i].pQueuePriorities = &queue_priority;
+            queues_create_ci[i].pQueuePriorities = queue_priorities;
             queues_create_ci[i].flags = 0;
             queues_create_ci[i].pNext = NULL;
         }
         queues_create_ci[0].queueFamilyIndex = _physical_device.graphics_queue_index;
-        queues_create_ci[1].queueFamilyIndex = _physical_device.present_queue_index;
+
+        // A family may only be listed once. When graphics and present share it,
+        // a second queue from the family keeps presents off the graphics queue.
+        uint32_t present_queue_slot = 0;
+        if(_physical_device.num_queues > 1){
+            queues_create_ci[1].queueFamilyIndex = _physical_device.present_queue_index;
+        } else if(_physical_device.graphics_queue_count > 1){
+            queues_create_ci[0].queueCount = 2;
+            present_queue_slot = 1;
+        }
+
+        // Uploads get their own queue on a transfer only family
+        uint32_t num_queue_create_infos = _physical_device.num_queues;
+        VkBool32 dedicated_transfer = _physical_device.transfer_queue_index != _physical_device.graphics_queue_index;
+        if(dedicated_transfer){
+            queues_create_ci[num_queue_create_infos].queueFamilyIndex = _physical_device.transfer_queue_index;
+            num_queue_create_infos += 1;
+        }
+
+        if(!_physical_device.features12.timelineSemaphore){
+            fprintf(stderr, "ERROR: physical device does not support timeline semaphores\n");
+            exit(EXIT_FAILURE);
+        }
 
         VkPhysicalDeviceFeatures features = {0};
 
+        VkPhysicalDeviceVulkan12Features features12 = {0};
+        features12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+        features12.pNext = NULL;
+        features12.timelineSemaphore = VK_TRUE;
+
         VkDeviceCreateInfo device_ci = {0};
         device_ci.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
-        device_ci.pNext = NULL;
+        device_ci.pNext = &features12;
         device_ci.pQueueCreateInfos = queues_create_ci;
-        device_ci.queueCreateInfoCount = _physical_device.num_queues;
+        device_ci.queueCreateInfoCount = num_queue_create_infos;
         device_ci.pEnabledFeatures = &features;
         device_ci.enabledLayerCount = 0;
         device_ci.ppEnabledLayerNames = NULL;
-        device_ci.enabledExtensionCount = NUM_REQUIRED_PHYSICAL_DEVICE_EXTENSIONS;
-        device_ci.ppEnabledExtensionNames = _required_physical_device_extensions;
 
-        VK_CHECK(vkCreateDevice, _physical_device.handle, &device_ci, NULL, &_device);
+        // Memory budget is optional, the allocator falls back to its own accounting
+        const char* device_extensions[NUM_REQUIRED_PHYSICAL_DEVICE_EXTENSIONS + 1];
+        uint32_t num_device_extensions = NUM_REQUIRED_PHYSICAL_DEVICE_EXTENSIONS;
+        memcpy(device_extensions, _required_physical_device_extensions, sizeof(_required_physical_device_extensions));
+        if(_physical_device.memory_budget){
+            device_extensions[num_device_extensions] = VK_EXT_MEMORY_BUDGET_EXTENSION_NAME;
+            num_device_extensions += 1;
+        }
+        device_ci.enabledExtensionCount = num_device_extensions;
+        device_ci.ppEnabledExtensionNames = device_extensions;
+
+        VK_CHECK(vkCreateDevice, _physical_device.handle, &device_ci, GetHostAllocator(), &_device);
 
         vkGetDeviceQueue(_device, _physical_device.graphics_queue_index, 0, &_graphics_queue);
-        vkGetDeviceQueue(_device, _physical_device.present_queue_index, 0, &_present_queue);
+        vkGetDeviceQueue(_device, _physical_device.present_queue_index, present_queue_slot, &_present_queue);
+
+        InitQueueTimeline(_device, _graphics_queue, _physical_device.graphics_queue_index, &_graphics_timeline);
+        InitDeletionQueue(_device, &_graphics_timeline);
+        InitGpuAllocator(_device, &_physical_device.mem_properties, _physical_device.limits.bufferImageGranularity);
+        if(_physical_device.memory_budget){
+            EnableGpuMemoryBudget(_physical_device.handle);
+        }
+
+        // Without a transfer only family the copies go to the graphics queue
+        if(dedicated_transfer){
+            vkGetDeviceQueue(_device, _physical_device.transfer_queue_index, 0, &_transfer_queue);
+            InitQueueTimeline(_device, _transfer_queue, _physical_device.transfer_queue_index, &_transfer_timeline);
+            InitTransferManager(_device, &_transfer_timeline, &_graphics_timeline, _physical_device.transfer_granularity);
+        } else {
+            InitTransferManager(_device, &_graphics_timeline, &_graphics_timeline, _physical_device.transfer_granularity);
+        }
+
+        if(_async_present){
+            _StartPresentThread();
+        }
+
+        // GPU frame time drives how late low latency mode can start a frame
+        _gpu_timestamps = _physical_device.limits.timestampComputeAndGraphics && _physical_device.timestamp_valid_bits > 0;
+        InitLatencyTracker();
+    }
+
+    {   // Worker threads for parallel work such as command recording
+        InitJobPool(0);
+
+        // A count set before INIT_VREND could not be clamped yet
+        SET_VREND_RECORD_THREADS(_record_threads);
     }
 
     {   // Create command pool
@@ -296,64 +534,575 @@ void INIT_VREND(char* title, uint32_t w, uint32_t h){
         VkCommandPoolCreateInfo command_pool_ci = GetCommandPoolCI(
             _physical_device.graphics_queue_index, VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT
         );
-        VK_CHECK(vkCreateCommandPool, _device, &command_pool_ci, NULL, &_command_pool);
+        VK_CHECK(vkCreateCommandPool, _device, &command_pool_ci, GetHostAllocator(), &_command_pool);
+
+    }
+
+    {   // Per frame uniform layout, shared by every swap chain
+        VkDescriptorSetLayoutBinding binding = {0};
+        binding.binding = 0;
+        binding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+        binding.descriptorCount = 1;
+        binding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+        binding.pImmutableSamplers = NULL;
+
+        VkDescriptorSetLayoutCreateInfo set_layout_ci = GetDescriptorSetLayoutCI(1, &binding);
+        VK_CHECK(vkCreateDescriptorSetLayout, _device, &set_layout_ci, GetHostAllocator(), &_frame_set_layout);
+    }
+
+    {   // Pipeline cache, must exist before the first pipeline is created
+        _record_stats.pipeline_cache_warm = LoadPipelineCache(
+            _device, &_physical_device.properties, _pipeline_cache_path, &_pipeline_cache
+        );
+        InitPipelineCompiler(_device, _pipeline_cache);
+        InitPipelineRegistry(_device);
+        InitShaderCache(_device);
+    }
 
+    {   // Shader hot reload, only for shaders loaded from disk
+        if(_shader_dir != NULL){
+            for(uint32_t i = 0; i < NUM_PIPELINE_SHADERS; i ++){
+                WatchShader(_shader_sources[i], _shader_outputs[i]);
+            }
+            StartShaderWatcher(_shader_dir);
+        }
     }
 
     {   // Swap chain creation
         _CreateSwapChain();
     }
 
-    {   // Initialize sync structures
+    {   // Per frame command buffers and sync structures
+        _CreateCommandBuffers();
+        _CreateSyncStructures();
+    }
+
+    _record_stats.init_ms = (double)(SDL_GetPerformanceCounter() - _init_start) / SDL_GetPerformanceFrequency() * 1000;
+    _host_allocations_at_init = GetHostAllocationCount();
+}
 
-        VkFenceCreateInfo fence_ci = GetFenceCI(VK_FENCE_CREATE_SIGNALED_BIT);
-        VK_CHECK(vkCreateFence, _device, &fence_ci, NULL, &_render_fence);
+void SET_VREND_PIPELINE_CACHE_PATH(const char* path){
+    _pipeline_cache_path = path;
+}
 
-        VkSemaphoreCreateInfo semaphore_ci = GetSemaphoreCI(0);
-        VK_CHECK(vkCreateSemaphore, _device, &semaphore_ci, NULL, &_present_semaphore);
-        VK_CHECK(vkCreateSemaphore, _device, &semaphore_ci, NULL, &_render_semaphore);
+void SET_VREND_SHADER_DIR(const char* dir){
+    _shader_dir = dir;
+}
+
+void SET_VREND_HOST_ALLOCATOR(VkBool32 enable){
+    _host_allocator = enable;
+}
+
+void SET_VREND_FRAMES_IN_FLIGHT(uint32_t count){
+
+    if(count < 1) count = 1;
+    if(count > MAX_FRAMES_IN_FLIGHT) count = MAX_FRAMES_IN_FLIGHT;
+
+    // Before INIT_VREND only the count needs to change
+    if(_device == NULL){
+        _num_frames_in_flight = count;
+        return;
     }
 
+    // Render commands may run in the middle of a frame, which still uses its frame slot
+    _requested_frames_in_flight = count != _num_frames_in_flight ? count : 0;
 }
 
-void FREE_VREND(){
+void _ResizeFrames(uint32_t count){
+    WaitQueueTimeline(_device, &_graphics_timeline, GetQueueTimelineLastSubmitted(&_graphics_timeline));
+    WaitPresentIdle();
+    _FreeFrames();
+    _num_frames_in_flight = count;
+    _CreateCommandBuffers();
+    _CreateSyncStructures();
+}
 
-    vkDeviceWaitIdle(_device);
+void SET_VREND_RECORD_THREADS(uint32_t count){
+    uint32_t max_threads = GetJobWorkerCount() + 1;
+    if(_device != NULL && count > max_threads) count = max_threads;
+    _record_threads = count;
+}
+
+void SET_VREND_GRID(uint32_t columns, uint32_t rows){
+    if(columns == 0 || rows == 0) columns = rows = 0;
+    _grid_columns = columns;
+    _grid_rows = rows;
+
+    // Whether there is a grid at all is baked into the pipeline, its size
+    // stays a uniform. Both variants stay in the registry once compiled.
+    if(_device != NULL){
+        SetSpecializationBool(&_pipeline_description.vert_constants, SPEC_GRID_ENABLED, _grid_columns > 0);
+        _pipeline = NULL;
+    }
+    MARK_VREND_DIRTY();
+}
 
-    vkDestroyPipeline(_device, _pipeline, NULL);
-    vkDestroyPipelineLayout(_device, _pipeline_layout, NULL);
+void BENCH_VREND_RECORDING(uint32_t num_frames){
 
-    vkDestroyFence(_device, _render_fence, NULL);
-    vkDestroySemaphore(_device, _render_semaphore, NULL);
-    vkDestroySemaphore(_device, _present_semaphore, NULL);
+    // Nothing recorded here is submitted, so frame 0 only has to be idle
+    WaitQueueTimeline(_device, &_graphics_timeline, GetQueueTimelineLastSubmitted(&_graphics_timeline));
+
+    // Without the pipeline no draws are recorded
+    if(_pipeline == NULL){
+        _UpdatePipeline(VK_TRUE);
+        MARK_VREND_DIRTY();
+    }
+
+    struct FrameData* frame = &_frames[0];
+    struct VrendRecordStats saved_stats = _record_stats;
+    uint32_t saved_threads = _record_threads;
+    uint32_t max_threads = GetJobWorkerCount() + 1;
+    double single_ms = 0.0;
+
+    printf("RECORDING BENCHMARK (%u draws, %u frames)\n{\n", _GetNumDraws(), num_frames);
+    for(uint32_t threads = 0; threads <= max_threads; threads ++){
+        _record_threads = threads;
+
+        Uint64 start = SDL_GetPerformanceCounter();
+        for(uint32_t i = 0; i < num_frames; i ++){
+            _ResetWorkerCommands(frame);
+            VK_CHECK_S(vkResetCommandBuffer, frame->command_buffer, 0);
+            _RecordFrame(frame->command_buffer, 0, VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT, frame);
+        }
+        double ms = (double)(SDL_GetPerformanceCounter() - start) / SDL_GetPerformanceFrequency() * 1000 / num_frames;
+
+        if(threads == 0){
+            printf("\tInline: %.4f ms/frame\n", ms);
+        } else {
+            if(threads == 1) single_ms = ms;
+            printf("\t%2u threads: %.4f ms/frame (%.2fx)\n", threads, ms, single_ms / ms);
+        }
+    }
+    printf("}\n\n");
 
-    vkDestroyRenderPass(_device, _render_pass, NULL);
-    vkFreeCommandBuffers(_device, _command_pool, 1, &_command_buffer);
-    vkDestroyCommandPool(_device, _command_pool, NULL);
+    _ResetWorkerCommands(frame);
+    VK_CHECK_S(vkResetCommandBuffer, frame->command_buffer, 0);
+    _record_threads = saved_threads;
+    _record_stats = saved_stats;
+}
+
+void BENCH_VREND_MEMORY(uint32_t num_allocations){
+
+    // Raw allocations count against maxMemoryAllocationCount, leave room for everything else
+    uint32_t max_raw = _physical_device.limits.maxMemoryAllocationCount / 2;
+    if(num_allocations > max_raw) num_allocations = max_raw;
+
+    uint32_t memory_type = FindGpuMemoryType(UINT32_MAX, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, 0);
+    VkDeviceMemory* memories = malloc(sizeof(VkDeviceMemory) * num_allocations);
+    struct GpuAllocation* allocations = malloc(sizeof(struct GpuAllocation) * num_allocations);
+    Uint64 frequency = SDL_GetPerformanceFrequency();
+
+    // Sizes from 256 bytes to 32 KiB, like small buffers
+    Uint64 start = SDL_GetPerformanceCounter();
+    for(uint32_t i = 0; i < num_allocations; i ++){
+        VkMemoryAllocateInfo memory_ai = {0};
+        memory_ai.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+        memory_ai.pNext = NULL;
+        memory_ai.allocationSize = 256 << (i % 8);
+        memory_ai.memoryTypeIndex = memory_type;
+        VK_CHECK_S(vkAllocateMemory, _device, &memory_ai, GetHostAllocator(), &memories[i]);
+    }
+    Uint64 raw_allocated = SDL_GetPerformanceCounter();
+    for(uint32_t i = 0; i < num_allocations; i ++){
+        vkFreeMemory(_device, memories[i], GetHostAllocator());
+    }
+    Uint64 raw_freed = SDL_GetPerformanceCounter();
+
+    for(uint32_t i = 0; i < num_allocations; i ++){
+        VkMemoryRequirements requirements = { 256 << (i % 8), 256, 1u << memory_type };
+        VK_CHECK_S(GpuAllocate, &requirements, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, 0, VK_TRUE, &allocations[i]);
+    }
+    Uint64 sub_allocated = SDL_GetPerformanceCounter();
+    struct GpuAllocatorStats stats = {0};
+    GetGpuAllocatorStats(&stats);
+    for(uint32_t i = 0; i < num_allocations; i ++){
+        GpuFree(&allocations[i]);
+    }
+    Uint64 sub_freed = SDL_GetPerformanceCounter();
+
+    double raw_alloc_us = (double)(raw_allocated - start) / frequency * 1000000 / num_allocations;
+    double raw_free_us = (double)(raw_freed - raw_allocated) / frequency * 1000000 / num_allocations;
+    double sub_alloc_us = (double)(sub_allocated - raw_freed) / frequency * 1000000 / num_allocations;
+    double sub_free_us = (double)(sub_freed - sub_allocated) / frequency * 1000000 / num_allocations;
+
+    printf("MEMORY BENCHMARK (%u allocations, memory type %u)\n{\n", num_allocations, memory_type);
+    printf("\tvkAllocateMemory: %.3f us alloc, %.3f us free, %u device allocations\n", raw_alloc_us, raw_free_us, num_allocations);
+    printf("\tSub-allocator: %.3f us alloc, %.3f us free, %u device allocations\n", sub_alloc_us, sub_free_us, stats.num_blocks);
+    printf("\tSpeedup: %.2fx alloc, %.2fx free\n", raw_alloc_us / sub_alloc_us, raw_free_us / sub_free_us);
+    printf("\tLive %llu bytes in %llu bytes of ranges\n",
+        (unsigned long long)stats.live_bytes, (unsigned long long)stats.used_bytes
+    );
+    printf("}\n\n");
+
+    free(allocations);
+    free(memories);
+}
+
+void BENCH_VREND_UPLOAD(uint32_t megabytes){
+    VkDeviceSize size = (VkDeviceSize)megabytes * 1024 * 1024;
+    uint8_t* data = malloc(size);
+    memset(data, 0xa5, size);
+
+    VkBuffer buffer = NULL;
+    struct GpuAllocation allocation = {0};
+    VkBufferCreateInfo buffer_ci = GetBufferCI(
+        size, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT
+    );
+    VK_CHECK(CreateGpuBuffer, &buffer_ci, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, 0, &buffer, &allocation);
+
+    // Frames keep being drawn while the upload streams, the slowest one shows any hitch
+    Uint64 frequency = SDL_GetPerformanceFrequency();
+    Uint64 start = SDL_GetPerformanceCounter();
+    Uint64 last = start;
+    double max_frame_ms = 0.0;
+    uint32_t num_frames = 0;
+    uint64_t ticket = UploadBuffer(buffer, 0, data, size);
+    while(!IsTransferReady(ticket)){
+        if(GET_VREND_STATE() == VREND_STATE_HIDDEN){
+            WaitTransfer(ticket);
+            break;
+        }
+        DRAW_VREND();
+        Uint64 now = SDL_GetPerformanceCounter();
+        double frame_ms = (double)(now - last) / frequency * 1000;
+        if(frame_ms > max_frame_ms) max_frame_ms = frame_ms;
+        last = now;
+        num_frames += 1;
+    }
+    double total_ms = (double)(SDL_GetPerformanceCounter() - start) / frequency * 1000;
+
+    struct TransferStats stats = {0};
+    GetTransferStats(&stats);
+    printf("UPLOAD BENCHMARK (%u MiB, %s queue)\n{\n", megabytes, stats.dedicated ? "transfer" : "graphics");
+    printf("\tTotal: %.1f ms, %.1f MiB/s\n", total_ms, megabytes / (total_ms / 1000));
+    printf("\tFrames during upload: %u, slowest %.2f ms\n", num_frames, max_frame_ms);
+    printf("\tBatches: %llu, largest %llu bytes, %llu frames deferred\n",
+        (unsigned long long)stats.batches, (unsigned long long)stats.max_batch_bytes,
+        (unsigned long long)stats.deferred_frames
+    );
+    printf("}\n\n");
+
+    _RetireObject((struct Deletion){ .type = DELETION_BUFFER, .handle.buffer = buffer });
+    _RetireObject((struct Deletion){ .type = DELETION_ALLOCATION, .handle.allocation = allocation });
+    free(data);
+}
+
+void SET_VREND_ASYNC_PRESENT(VkBool32 enable){
+    _async_present = enable;
+    if(_device == NULL) return;
+
+    if(enable){
+        _StartPresentThread();
+    } else {
+        FreePresentThread();
+    }
+}
+
+void SET_VREND_PRESENT_MODE(VkPresentModeKHR present_mode){
+    if(present_mode == _requested_present_mode) return;
+    _requested_present_mode = present_mode;
+    _vblank_estimate = 0;
+    if(_device != NULL){
+        _swap_chain_stale = VK_TRUE;
+    }
+}
+
+void SET_VREND_SWAP_CHAIN_IMAGES(uint32_t count){
+    if(count == _requested_num_images) return;
+    _requested_num_images = count;
+    if(_device != NULL){
+        _swap_chain_stale = VK_TRUE;
+    }
+}
+
+uint32_t GET_VREND_SWAP_CHAIN_IMAGES(){
+    return _swap_chain.num_images;
+}
+
+void SET_VREND_LOW_LATENCY(VkBool32 enable){
+    _low_latency = enable;
+    _vblank_estimate = 0;
+}
+
+void MARK_VREND_INPUT(Uint64 timestamp){
+    if(_pending_input_time == 0 || timestamp < _pending_input_time){
+        _pending_input_time = timestamp;
+    }
+}
+
+void SET_VREND_PRERECORD(VkBool32 enable){
+    _prerecord = enable;
+    MARK_VREND_DIRTY();
+}
+
+void MARK_VREND_DIRTY(){
     for(uint32_t i = 0; i < _swap_chain.num_images; i ++){
-        vkDestroyFramebuffer(_device, _swap_chain.framebuffers[i], NULL);
-        vkDestroyImageView(_device, _swap_chain.image_views[i], NULL);
+        _swap_chain.dirty[i] = VK_TRUE;
+    }
+    REQUEST_VREND_REDRAW();
+}
+
+void SET_VREND_VISIBLE(VkBool32 visible){
+    _visible = visible;
+
+    // The surface may have its size back, the next frame finds out
+    if(visible){
+        _zero_extent = VK_FALSE;
+        REQUEST_VREND_REDRAW();
+    }
+}
+
+void SET_VREND_ON_DEMAND(VkBool32 enable){
+    _on_demand = enable;
+    REQUEST_VREND_REDRAW();
+}
+
+void PAUSE_VREND(VkBool32 pause){
+    _paused = pause;
+    REQUEST_VREND_REDRAW();
+}
+
+VkBool32 IS_VREND_PAUSED(){
+    return _paused;
+}
+
+void REQUEST_VREND_REDRAW(){
+    _redraw_requested = VK_TRUE;
+}
+
+void STEP_VREND(double seconds){
+    if(_paused) return;
+    _sim_time += seconds;
+
+    // The background animates, so every step changes the view
+    REQUEST_VREND_REDRAW();
+}
+
+enum VrendState GET_VREND_STATE(){
+    if(!_visible || _zero_extent){
+        return VREND_STATE_HIDDEN;
+    }
+    // A compile, upload or shader reload in flight keeps frames coming so it gets picked up
+    struct TransferStats transfer_stats = {0};
+    GetTransferStats(&transfer_stats);
+    if(_on_demand && !_redraw_requested && _pipeline != NULL && transfer_stats.unready_uploads == 0
+            && !_reload_pending && !HasShaderChanges()){
+        return VREND_STATE_IDLE;
     }
-    free(_swap_chain.images);
-    free(_swap_chain.image_views);
-    vkDestroySwapchainKHR(_device, _swap_chain.handle, NULL);
-    vkDestroyDevice(_device, NULL);
+    return VREND_STATE_ACTIVE;
+}
+
+void GET_VREND_RECORD_STATS(struct VrendRecordStats* stats){
+    *stats = _record_stats;
+}
+
+void PRINT_VREND_STATS(){
+    printf("VREND STATS\n{\n");
+    printf("\tCommand recording: %s\n", _prerecord ? "pre-recorded" : "per frame");
+    printf("\tRecord threads: %u\n", _record_threads);
+    printf("\tDraws per frame: %u\n", _GetNumDraws());
+    printf("\tFrames recorded: %llu\n", (unsigned long long)_record_stats.frames_recorded);
+    printf("\tFrames reused: %llu\n", (unsigned long long)_record_stats.frames_reused);
+    printf("\tRecord time: %.4f ms\n", _record_stats.record_ms);
+    printf("\tRecord time saved: %.2f ms\n", _record_stats.saved_ms);
+    printf("\tPresent mode: %s\n", STR_VK_PRESENT_MODE_KHR(_swap_chain.present_mode));
+    printf("\tSwap chain images: %u\n", _swap_chain.num_images);
+    printf("\tSwap chain creations: %llu, last took %.3f ms\n",
+        (unsigned long long)_record_stats.swap_chain_recreations, _record_stats.recreate_ms
+    );
+    printf("\tPending deletions: %u\n", GetPendingDeletionCount());
+    struct GpuAllocatorStats memory_stats = {0};
+    GetGpuAllocatorStats(&memory_stats);
+    printf("\tGPU memory: %u blocks (%u dedicated), %llu bytes, %u allocations, %llu bytes live\n",
+        memory_stats.num_blocks, memory_stats.num_dedicated, (unsigned long long)memory_stats.block_bytes,
+        memory_stats.num_allocations, (unsigned long long)memory_stats.live_bytes
+    );
+    printf("\tGPU memory fragmentation: %.1f%%, largest free range %llu bytes\n",
+        memory_stats.fragmentation * 100.0, (unsigned long long)memory_stats.largest_free
+    );
+    struct UploadRing* ring = &_swap_chain.upload_ring;
+    printf("\tUpload ring: %u partitions of %llu bytes, %s, peak %llu bytes per frame\n",
+        ring->num_partitions, (unsigned long long)ring->partition_size,
+        ring->coherent ? "coherent" : "flushed", (unsigned long long)ring->peak_bytes
+    );
+    printf("\tUploads: %llu bytes, %llu overflows, %llu stalls\n",
+        (unsigned long long)ring->bytes_uploaded, (unsigned long long)ring->num_overflows,
+        (unsigned long long)ring->num_stalls
+    );
+    struct TransferStats transfer_stats = {0};
+    GetTransferStats(&transfer_stats);
+    printf("\tTransfer queue: %s\n", transfer_stats.dedicated ? "dedicated" : "graphics");
+    printf("\tUploads: %llu, %llu bytes in %llu batches, largest %llu bytes, %llu frames deferred, %llu staging trims\n",
+        (unsigned long long)transfer_stats.uploads, (unsigned long long)transfer_stats.bytes,
+        (unsigned long long)transfer_stats.batches, (unsigned long long)transfer_stats.max_batch_bytes,
+        (unsigned long long)transfer_stats.deferred_frames, (unsigned long long)transfer_stats.staging_trims
+    );
+    if(_host_allocator){
+        for(uint32_t scope = 0; scope < NUM_HOST_SCOPES; scope ++){
+            struct HostScopeStats host_stats = {0};
+            GetHostScopeStats(scope, &host_stats);
+            printf("\tHost %s: %llu allocations, %llu live, %llu bytes (peak %llu), %llu bytes of slabs, %llu large\n",
+                STR_VK_SYSTEM_ALLOCATION_SCOPE(scope), (unsigned long long)host_stats.allocations,
+                (unsigned long long)host_stats.live_count, (unsigned long long)host_stats.live_bytes,
+                (unsigned long long)host_stats.peak_bytes, (unsigned long long)host_stats.slab_bytes,
+                (unsigned long long)host_stats.large
+            );
+        }
+
+        // Anything above zero here is driver churn in the frame loop
+        uint64_t frame_allocations = GetHostAllocationCount() - _host_allocations_at_init;
+        printf("\tHost allocations per frame: %.2f\n", _frame_counter > 0 ? (double)frame_allocations / _frame_counter : 0.0);
+    }
+    struct GpuHeapBudget heaps[VK_MAX_MEMORY_HEAPS];
+    uint32_t num_heaps = GetGpuHeapBudgets(heaps);
+    printf("\tGPU memory budget: %s, pressure %s\n",
+        IsGpuMemoryBudgetEnabled() ? "VK_EXT_memory_budget" : "own accounting",
+        _memory_usage.pressure == VREND_MEMORY_PRESSURE_CRITICAL ? "critical" :
+        _memory_usage.pressure == VREND_MEMORY_PRESSURE_HIGH ? "high" : "none"
+    );
+    for(uint32_t i = 0; i < num_heaps; i ++){
+        printf("\tGPU heap %u%s: %llu of %llu bytes budget used, %llu in our blocks, %llu bytes in heap\n",
+            i, heaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT ? " (device local)" : "",
+            (unsigned long long)heaps[i].usage, (unsigned long long)heaps[i].budget,
+            (unsigned long long)heaps[i].block_bytes, (unsigned long long)heaps[i].size
+        );
+    }
+    printf("\tHost arenas: frame %zu bytes (peak %zu), init %zu bytes, %llu blocks allocated\n",
+        _frame_arena.capacity, _frame_arena.peak_bytes, _init_arena.used,
+        (unsigned long long)GetArenaBlockAllocations()
+    );
+
+    // Only the first frames should show up here, later ones fit in the arenas.
+    // Modules outside vrend.c allocate on their own and are not counted.
+    printf("\tFrames growing an arena: %llu, last was frame %u\n",
+        (unsigned long long)_arena_frames, _last_arena_frame
+    );
+    printf("\tPipeline cache: %s\n", _pipeline_cache_path == NULL ? "off" : _record_stats.pipeline_cache_warm ? "warm" : "cold");
+    struct PipelineRegistryStats pipeline_stats = {0};
+    GetPipelineRegistryStats(&pipeline_stats);
+    printf("\tPipelines: %u, %u compiling\n", pipeline_stats.num_pipelines, pipeline_stats.num_pending);
+    printf("\tPipeline lookups: %llu hits, %llu misses, %llu while compiling\n",
+        (unsigned long long)pipeline_stats.hits, (unsigned long long)pipeline_stats.misses,
+        (unsigned long long)pipeline_stats.waits
+    );
+    struct ShaderCacheStats shader_stats = {0};
+    GetShaderCacheStats(&shader_stats);
+    printf("\tShader modules: %u, %llu bytes of SPIR-V, %llu files read, %llu hits, %.3f ms loading\n",
+        shader_stats.num_modules, (unsigned long long)shader_stats.code_bytes,
+        (unsigned long long)shader_stats.files_read, (unsigned long long)shader_stats.hits, shader_stats.load_ms
+    );
+    printf("\tPipeline compile time: %.3f ms total, %.3f ms max\n", pipeline_stats.compile_ms, pipeline_stats.max_compile_ms);
+    printf("\tFrames drawn without pipeline: %llu\n", (unsigned long long)_record_stats.frames_skipped);
+    printf("\tStartup: %.3f ms, first frame submitted after %.3f ms\n", _record_stats.init_ms, _record_stats.first_frame_ms);
+    if(_shader_dir != NULL){
+        printf("\tShader reloads: %llu, last took %.1f ms from save to first frame\n",
+            (unsigned long long)_record_stats.shader_reloads, _record_stats.reload_ms
+        );
+    }
+    printf("\tLow latency: %s\n", _low_latency ? "on" : "off");
+    printf("\tOn demand: %s\n", _on_demand ? "on" : "off");
+    printf("\tFrames drawn: %u\n", _frame_counter);
+    if(_gpu_timestamps){
+        printf("\tGPU frame time: %.4f ms\n", _record_stats.gpu_ms);
+    }
+    printf("\tPresent: %s\n", IsPresentThreadRunning() ? "present thread" : "inline");
+    printf("\tPresent time on render thread: %.4f ms\n", _record_stats.present_ms);
+    if(IsPresentThreadRunning()){
+        printf("\tPresent time on present thread: %.4f ms\n", GetPresentCallMs());
+    }
+    printf("}\n\n");
+}
+
+void FREE_VREND(){
+
+    // The render thread finishes its frame before anything is destroyed
+    StopRenderThread();
+    StopShaderWatcher();
+    FreePresentThread();
+    FreeLatencyTracker();
+
+    vkDeviceWaitIdle(_device);
+
+    // Per image resources go through the deletion queue, which has to be
+    // flushed while the timeline and command pool still exist
+    _FreeSwapChainImages();
+    _FreeFrameUniforms();
+    _FreeImageCommandBuffers();
+    _FreeTimestampQueries();
+    _RetireSwapChains(GetQueueTimelineLastSubmitted(&_graphics_timeline));
+    FreeDeletionQueue();
+    FreeTransferManager();
+    FreeGpuAllocator();
+
+    FreePipelineRegistry();
+    vkDestroyPipelineLayout(_device, _pipeline_layout, GetHostAllocator());
+    FreeShaderCache();
+    SavePipelineCache(_device, _pipeline_cache, _pipeline_cache_path);
+    vkDestroyPipelineCache(_device, _pipeline_cache, GetHostAllocator());
+
+    _FreeFrames();
+    FreeQueueTimeline(_device, &_graphics_timeline);
+    if(_transfer_queue != NULL){
+        FreeQueueTimeline(_device, &_transfer_timeline);
+    }
+    FreeJobPool();
+
+    vkDestroyRenderPass(_device, _render_pass, GetHostAllocator());
+    vkDestroyCommandPool(_device, _command_pool, GetHostAllocator());
+    vkDestroyDescriptorSetLayout(_device, _frame_set_layout, GetHostAllocator());
+    vkDestroySwapchainKHR(_device, _swap_chain.handle, GetHostAllocator());
+    vkDestroyDevice(_device, GetHostAllocator());
     vkDestroySurfaceKHR(_instance, _surface, NULL);
     #ifdef DEBUG
         FreeDebugUtils(&_instance);
     #endif
-    vkDestroyInstance(_instance, NULL);
+    vkDestroyInstance(_instance, GetHostAllocator());
+    FreeHostAllocator();
+    FreeArena(&_frame_arena);
+    FreeArena(&_init_arena);
     SDL_DestroyWindow(_window);
     SDL_Quit();
 }
 
+VkPresentModeKHR GET_VREND_PRESENT_MODE(){
+    return _swap_chain.present_mode;
+}
+
+int QUERY_VREND_REFRESH_RATE(){
+    SDL_DisplayMode mode = {0};
+    if(SDL_GetWindowDisplayMode(_window, &mode) != 0){
+        return 0;
+    }
+    return mode.refresh_rate;
+}
+
+void SET_VREND_REFRESH_RATE(int refresh_hz){
+    _refresh_rate = refresh_hz > 0 ? refresh_hz : 0;
+}
+
+int GET_VREND_REFRESH_RATE(){
+    return _refresh_rate;
+}
+
 void _CreateSwapChain(){
 
-    vkDeviceWaitIdle(_device);
+    // Nothing waits for the GPU, old objects are retired to the deletion queue.
+    // The old swap chain is passed as oldSwapchain, so it must not be in use
+    // by a present call on the present thread.
+    WaitPresentIdle();
 
     vkGetPhysicalDeviceSurfaceCapabilitiesKHR(_physical_device.handle, _surface, &_physical_device.capabilities);
     _window_extent = _physical_device.capabilities.currentExtent;
 
+    // Keep the old swap chain and stop drawing until SET_VREND_VISIBLE. The
+    // first frame after that creates it with whatever was requested meanwhile.
+    // Only the first creation, on the main thread in INIT_VREND, has to wait.
+    if((_window_extent.width == 0 || _window_extent.height == 0) && _swap_chain.handle != NULL){
+        _zero_extent = VK_TRUE;
+        _swap_chain_stale = VK_TRUE;
+        return;
+    }
+    _swap_chain_stale = VK_FALSE;
     while(_window_extent.width == 0 || _window_extent.height == 0){
         vkGetPhysicalDeviceSurfaceCapabilitiesKHR(_physical_device.handle, _surface, &_physical_device.capabilities);
         _window_extent = _physical_device.capabilities.currentExtent;
@@ -363,28 +1112,21 @@ void _CreateSwapChain(){
         SDL_WaitEvent(&event);
     }
 
+    Uint64 start = SDL_GetPerformanceCounter();
     VkSurfaceCapabilitiesKHR c = _physical_device.capabilities;
 
-    uint32_t num_images = c.minImageCount + 1;
-    if(c.minImageCount > 0 && num_images > c.maxImageCount){
+    uint32_t num_images = _requested_num_images > 0 ? _requested_num_images : c.minImageCount + 1;
+    if(_pressure_min_images){
+        num_images = c.minImageCount;
+    }
+    if(num_images < c.minImageCount){
+        num_images = c.minImageCount;
+    }
+    if(c.maxImageCount > 0 && num_images > c.maxImageCount){
         num_images = c.maxImageCount;
     }
-
-    // Free structures if made before
-    if(_swap_chain.handle){
-        for(uint32_t i = 0; i < num_images; i ++){
-            vkDestroyFramebuffer(_device, _swap_chain.framebuffers[i], NULL);
-        }
-        free(_swap_chain.framebuffers);
-        vkDestroyPipeline(_device, _pipeline, NULL);
-        vkDestroyPipelineLayout(_device, _pipeline_layout, NULL);
-        vkDestroyRenderPass(_device, _render_pass, NULL);
-        vkFreeCommandBuffers(_device, _command_pool, 1, &_command_buffer);
-        for(uint32_t i = 0; i < num_images; i ++){
-            vkDestroyImageView(_device, _swap_chain.image_views[i], NULL);
-        }
-        free(_swap_chain.image_views);
-        vkDestroySwapchainKHR(_device, _swap_chain.handle, NULL);
+    if(num_images > MAX_SWAP_CHAIN_IMAGES){
+        num_images = MAX_SWAP_CHAIN_IMAGES;
     }
 
     VkSurfaceFormatKHR chosen_format = _physical_device.formats[0];
@@ -397,14 +1139,24 @@ void _CreateSwapChain(){
         }
     }
 
+    // FIFO is the only mode every surface supports
+    VkPresentModeKHR wanted_present_mode = _requested_present_mode;
+    if(wanted_present_mode == VREND_PRESENT_MODE_AUTO){
+        wanted_present_mode = VK_PRESENT_MODE_MAILBOX_KHR;
+    }
     VkPresentModeKHR chosen_present_mode = VK_PRESENT_MODE_FIFO_KHR;
     for(uint32_t i = 0; i < _physical_device.num_present_modes; i ++){
         VkPresentModeKHR present_mode = _physical_device.present_modes[i];
-        if(present_mode == VK_PRESENT_MODE_MAILBOX_KHR){
+        if(present_mode == wanted_present_mode){
             chosen_present_mode = present_mode;
             break;
         }
     }
+    if(_requested_present_mode != VREND_PRESENT_MODE_AUTO && chosen_present_mode != _requested_present_mode){
+        fprintf(stderr, "WARNING: %s is not supported, using %s\n",
+            STR_VK_PRESENT_MODE_KHR(_requested_present_mode), STR_VK_PRESENT_MODE_KHR(chosen_present_mode)
+        );
+    }
 
     VkSwapchainCreateInfoKHR ci = {0};
     ci.sType = VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR;
@@ -436,17 +1188,65 @@ void _CreateSwapChain(){
     ci.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
     ci.presentMode = chosen_present_mode;
     ci.clipped = VK_TRUE;
-    ci.oldSwapchain = NULL;
+    ci.oldSwapchain = _swap_chain.handle;
+
+    VkSwapchainKHR old_swap_chain = _swap_chain.handle;
+    VK_CHECK(vkCreateSwapchainKHR, _device, &ci, GetHostAllocator(), &_swap_chain.handle);
 
-    VK_CHECK(vkCreateSwapchainKHR, _device, &ci, NULL, &_swap_chain.handle);
+    uint32_t new_num_images = 0;
+    vkGetSwapchainImagesKHR(_device, _swap_chain.handle, &new_num_images, NULL);
+    if(new_num_images > MAX_SWAP_CHAIN_IMAGES){
+        fprintf(stderr, "ERROR: swap chain has %u images, at most %u are supported\n", new_num_images, MAX_SWAP_CHAIN_IMAGES);
+        exit(EXIT_FAILURE);
+    }
+
+    // Free structures if made before. Per image resources only depend on the image count.
+    VkBool32 image_count_changed = new_num_images != _swap_chain.num_images;
+    if(old_swap_chain != NULL){
+        if(image_count_changed){
+            _FreeFrameUniforms();
+            _FreeImageCommandBuffers();
+            _FreeTimestampQueries();
+        }
+        _FreeSwapChainImages();
+
+        // Presents of the old images may still be pending, so it goes once
+        // the first frame on the new swap chain has completed. Copy batches
+        // share the graphics timeline, so that frame's value is only known
+        // once it is submitted.
+        if(_num_retired_swap_chains == MAX_RETIRED_SWAP_CHAINS){
+
+            // Recreated repeatedly without drawing, the oldest have long been presented
+            WaitQueueTimeline(_device, &_graphics_timeline, GetQueueTimelineLastSubmitted(&_graphics_timeline));
+            _RetireSwapChains(GetQueueTimelineLastSubmitted(&_graphics_timeline));
+        }
+        _retired_swap_chains[_num_retired_swap_chains] = old_swap_chain;
+        _num_retired_swap_chains += 1;
+    }
 
-    vkGetSwapchainImagesKHR(_device, _swap_chain.handle, &_swap_chain.num_images, NULL);
-    _swap_chain.images = malloc(sizeof(VkImage) * _swap_chain.num_images);
+    _swap_chain.num_images = new_num_images;
     vkGetSwapchainImagesKHR(_device, _swap_chain.handle, &_swap_chain.num_images, _swap_chain.images);
 
-    _swap_chain.format = chosen_format.format;
+    // The render pass, and with it the pipeline, only depends on the format
+    if(_render_pass == NULL || chosen_format.format != _swap_chain.format){
+        if(_render_pass != NULL){
+            EvictPipelines(_render_pass, GetQueueTimelineLastSubmitted(&_graphics_timeline));
+            _RetireObject((struct Deletion){ .type = DELETION_PIPELINE_LAYOUT, .handle.pipeline_layout = _pipeline_layout });
+            _RetireObject((struct Deletion){ .type = DELETION_RENDER_PASS, .handle.render_pass = _render_pass });
+        }
+        _swap_chain.format = chosen_format.format;
+        _CreateRenderPass();
+        _CreateGraphicsPipeline();
+    }
+    _swap_chain.present_mode = chosen_present_mode;
+
+    // With new per image resources nothing is in flight yet. Otherwise uniform
+    // slots and pre-recorded command buffers are indexed by image and may still
+    // be in use by frames on the old swap chain.
+    if(image_count_changed){
+        memset(_swap_chain.images_in_flight, 0, sizeof(_swap_chain.images_in_flight));
+    }
 
-    _swap_chain.image_views = malloc(sizeof(VkImageView) * _swap_chain.num_images);
     for(uint32_t i = 0; i < _swap_chain.num_images; i ++){
         VkImageViewCreateInfo image_view_ci = {0};
         image_view_ci.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
@@ -463,7 +1263,7 @@ void _CreateSwapChain(){
         image_view_ci.subresourceRange.levelCount = 1;
         image_view_ci.subresourceRange.baseArrayLayer = 0;
         image_view_ci.subresourceRange.layerCount = 1;
-        VK_CHECK(vkCreateImageView, _device, &image_view_ci, NULL, &_swap_chain.image_views[i]);
+        VK_CHECK(vkCreateImageView, _device, &image_view_ci, GetHostAllocator(), &_swap_chain.image_views[i]);
     }
 
     #ifdef DEBUG
@@ -479,17 +1279,85 @@ void _CreateSwapChain(){
         // printf("}\n\n");
     #endif
 
-    _CreateCommandBuffers();
-    _CreateRenderPass();
-    _CreateGraphicsPipeline();
     _CreateFramebuffers();
+
+    if(image_count_changed){
+        _CreateFrameUniforms();
+        _CreateImageCommandBuffers();
+        _CreateTimestampQueries();
+    } else {
+        // Pre-recorded command buffers still reference the old framebuffers
+        MARK_VREND_DIRTY();
+    }
+
+    _record_stats.swap_chain_recreations += 1;
+    _record_stats.recreate_ms = (double)(SDL_GetPerformanceCounter() - start) / SDL_GetPerformanceFrequency() * 1000;
+}
+
+void _FreeSwapChainImages(){
+    for(uint32_t i = 0; i < _swap_chain.num_images; i ++){
+        _RetireObject((struct Deletion){ .type = DELETION_FRAMEBUFFER, .handle.framebuffer = _swap_chain.framebuffers[i] });
+        _RetireObject((struct Deletion){ .type = DELETION_IMAGE_VIEW, .handle.image_view = _swap_chain.image_views[i] });
+    }
+}
+
+void _RetireObject(struct Deletion deletion){
+
+    // Every frame submitted so far may still use it
+    QueueDeletion(deletion, GetQueueTimelineLastSubmitted(&_graphics_timeline));
+}
+
+void _RetireSwapChains(uint64_t timeline_value){
+    for(uint32_t i = 0; i < _num_retired_swap_chains; i ++){
+        struct Deletion deletion = { .type = DELETION_SWAP_CHAIN, .handle.swap_chain = _retired_swap_chains[i] };
+        QueueDeletion(deletion, timeline_value);
+    }
+    _num_retired_swap_chains = 0;
 }
 
 void _CreateCommandBuffers(){
     VkCommandBufferAllocateInfo command_buffer_ai = GetCommandBufferAI(
         _command_pool, 1, VK_COMMAND_BUFFER_LEVEL_PRIMARY
     );
-    VK_CHECK(vkAllocateCommandBuffers, _device, &command_buffer_ai, &_command_buffer);
+    for(uint32_t i = 0; i < _num_frames_in_flight; i ++){
+        VK_CHECK(vkAllocateCommandBuffers, _device, &command_buffer_ai, &_frames[i].command_buffer);
+    }
+
+    // Command pools are externally synchronized, so every recording thread gets its own
+    VkCommandPoolCreateInfo command_pool_ci = GetCommandPoolCI(
+        _physical_device.graphics_queue_index, VK_COMMAND_POOL_CREATE_TRANSIENT_BIT
+    );
+    for(uint32_t i = 0; i < _num_frames_in_flight; i ++){
+        for(uint32_t j = 0; j < GetJobSlotCount(); j ++){
+            struct WorkerCommands* worker = &_frames[i].workers[j];
+            VK_CHECK(vkCreateCommandPool, _device, &command_pool_ci, GetHostAllocator(), &worker->pool);
+            worker->num_used = 0;
+            worker->num_allocated = 0;
+        }
+    }
+}
+
+void _CreateSyncStructures(){
+    // Frame completion is tracked on the graphics timeline, the binary
+    // semaphores only connect acquire and present to the submission
+    VkSemaphoreCreateInfo semaphore_ci = GetSemaphoreCI(0);
+    for(uint32_t i = 0; i < _num_frames_in_flight; i ++){
+        _frames[i].timeline_value = 0;
+        VK_CHECK(vkCreateSemaphore, _device, &semaphore_ci, GetHostAllocator(), &_frames[i].present_semaphore);
+        VK_CHECK(vkCreateSemaphore, _device, &semaphore_ci, GetHostAllocator(), &_frames[i].render_semaphore);
+    }
+}
+
+void _FreeFrames(){
+    for(uint32_t i = 0; i < _num_frames_in_flight; i ++){
+        vkDestroySemaphore(_device, _frames[i].render_semaphore, GetHostAllocator());
+        vkDestroySemaphore(_device, _frames[i].present_semaphore, GetHostAllocator());
+        vkFreeCommandBuffers(_device, _command_pool, 1, &_frames[i].command_buffer);
+        for(uint32_t j = 0; j < GetJobSlotCount(); j ++){
+            vkDestroyCommandPool(_device, _frames[i].workers[j].pool, GetHostAllocator());
+        }
+        _frames[i] = (struct FrameData){0};
+    }
 }
 
 void _CreateRenderPass(){
@@ -525,24 +1393,345 @@ void _CreateRenderPass(){
         1, &subpass,
         1, &subpass_dependency
     );
-    VK_CHECK(vkCreateRenderPass, _device, &render_pass_ci, NULL, &_render_pass);
+    VK_CHECK(vkCreateRenderPass, _device, &render_pass_ci, GetHostAllocator(), &_render_pass);
 }
 
 void _CreateGraphicsPipeline(){
     
-    VkPipelineLayoutCreateInfo pipeline_layout = GetPipelineLayoutCI();
-    VK_CHECK(vkCreatePipelineLayout, _device, &pipeline_layout, NULL, &_pipeline_layout);
+    VkPipelineLayoutCreateInfo pipeline_layout = GetPipelineLayoutCI(1, &_frame_set_layout);
+    VK_CHECK(vkCreatePipelineLayout, _device, &pipeline_layout, GetHostAllocator(), &_pipeline_layout);
+
+    // Only created the first time, later compiles reuse the modules. That
+    // includes reloaded ones, so a reload in progress has nothing left to do.
+    _pipeline_description.vert_shader = _GetShader(_shader_names[0]);
+    _pipeline_description.frag_shader = _GetShader(_shader_names[1]);
+    if(_reload_pending){
+        _reload_pending = VK_FALSE;
+        _reload_swapped = VK_TRUE;
+        _RetireReplacedShaders();
+    }
+    _pipeline_description.layout = _pipeline_layout;
+    _pipeline_description.render_pass = _render_pass;
+    _pipeline_description.subpass = 0;
+    _pipeline_description.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+    _pipeline_description.polygon_mode = VK_POLYGON_MODE_FILL;
+    SetSpecializationBool(&_pipeline_description.vert_constants, SPEC_GRID_ENABLED, _grid_columns > 0);
+
+    // Frames are drawn without it until DRAW_VREND finds the compile done
+    _pipeline = NULL;
+    _UpdatePipeline(VK_FALSE);
+}
 
-    VkShaderModule vert_shader_module = NULL;
-    _LoadShaderModule("src/vert.spv", &vert_shader_module);
+// name is the file name without .spv
+VkShaderModule _GetShader(const char* name){
+    if(_shader_dir == NULL){
+        const struct EmbeddedShader* shader = GetEmbeddedShader(name);
+        if(shader == NULL){
+            fprintf(stderr, "ERROR: shader %s is not embedded\n", name);
+            exit(EXIT_FAILURE);
+        }
+        return GetShaderModuleFromCode(name, shader->code, shader->size);
+    }
 
-    VkShaderModule frag_shader_module = NULL;
-    _LoadShaderModule("src/frag.spv", &frag_shader_module);
+    char path[512];
+    _GetShaderPath(name, path, sizeof(path));
+    return GetShaderModule(path);
+}
 
-    VkPipelineShaderStageCreateInfo shader_stages[] = {
-        GetShaderStageCI(VK_SHADER_STAGE_VERTEX_BIT, vert_shader_module),
-        GetShaderStageCI(VK_SHADER_STAGE_FRAGMENT_BIT, frag_shader_module)
-    };
+void _GetShaderPath(const char* name, char* path, size_t size){
+    snprintf(path, size, "%s/%s.spv", _shader_dir, name);
+}
+
+// Runs at the start of a frame. The old pipeline keeps drawing until the one
+// from the reloaded shaders has compiled, and stays if that compile fails.
+void _UpdateShaderReload(){
+    uint32_t changed = 0;
+    Uint64 saved_time = 0;
+    if(TakeShaderChanges(&changed, &saved_time)){
+        if(!_reload_pending){
+            _reload_shaders[0] = _pipeline_description.vert_shader;
+            _reload_shaders[1] = _pipeline_description.frag_shader;
+            _reload_saved_time = saved_time;
+            _reload_pending = VK_TRUE;
+        }
+        for(uint32_t i = 0; i < NUM_PIPELINE_SHADERS; i ++){
+            if(changed & (1u << i)){
+                char path[512];
+                _GetShaderPath(_shader_names[i], path, sizeof(path));
+                _reload_shaders[i] = ReloadShaderModule(path);
+            }
+        }
+    }
+    if(!_reload_pending) return;
+
+    struct PipelineDescription description = _pipeline_description;
+    description.vert_shader = _reload_shaders[0];
+    description.frag_shader = _reload_shaders[1];
+    VkPipeline pipeline = NULL;
+    enum PipelineStatus status = GetPipeline(&description, &pipeline);
+    if(status == PIPELINE_STATUS_PENDING) return;
+
+    _reload_pending = VK_FALSE;
+    if(status == PIPELINE_STATUS_FAILED){
+        fprintf(stderr, "WARNING: pipeline from reloaded shaders failed to compile, keeping the old one\n");
+        return;
+    }
+    _pipeline_description = description;
+    _pipeline = pipeline;
+    _reload_swapped = VK_TRUE;
+    _RetireReplacedShaders();
+    MARK_VREND_DIRTY();
+}
+
+// Once nothing new is built from the old modules. Frames in flight may still
+// draw with their pipelines, so both wait for the last submitted frame.
+void _RetireReplacedShaders(){
+    uint64_t timeline_value = GetQueueTimelineLastSubmitted(&_graphics_timeline);
+    VkShaderModule module = NULL;
+    while((module = TakeReplacedShaderModule()) != NULL){
+        EvictShaderPipelines(module, timeline_value);
+        QueueDeletion((struct Deletion){ .type = DELETION_SHADER_MODULE, .handle.shader_module = module }, timeline_value);
+    }
+}
+
+// Returns VK_FALSE while the compile is still running
+VkBool32 _UpdatePipeline(VkBool32 wait){
+    if(wait){
+        WaitPipelines();
+    }
+    enum PipelineStatus status = GetPipeline(&_pipeline_description, &_pipeline);
+    if(status == PIPELINE_STATUS_FAILED){
+        fprintf(stderr, "ERROR: failed to compile graphics pipeline\n");
+        exit(EXIT_FAILURE);
+    }
+    return status == PIPELINE_STATUS_READY;
+}
+
+void _CreateFramebuffers(){
+    VkFramebufferCreateInfo framebuffer_ci = {0};
+    framebuffer_ci.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+    framebuffer_ci.pNext = NULL;
+    framebuffer_ci.renderPass = _render_pass;
+    framebuffer_ci.attachmentCount = 1;
+    framebuffer_ci.width = _window_extent.width;
+    framebuffer_ci.height = _window_extent.height;
+    framebuffer_ci.layers = 1;
+
+    for(uint32_t i = 0; i < _swap_chain.num_images; i ++){
+        framebuffer_ci.pAttachments = &_swap_chain.image_views[i];
+        VK_CHECK(vkCreateFramebuffer, _device, &framebuffer_ci, GetHostAllocator(), &_swap_chain.framebuffers[i]);
+    }
+}
+
+void _CreateFrameUniforms(){
+
+    // Partitions follow the images rather than the frames in flight, since
+    // pre-recorded command buffers bind the uniforms of their image
+    InitUploadRing(
+        _device, &_graphics_timeline, DEFAULT_UPLOAD_PARTITION_SIZE, _swap_chain.num_images,
+        _physical_device.limits.nonCoherentAtomSize,
+        VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT |
+        VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+        &_swap_chain.upload_ring
+    );
+
+    VkDescriptorPoolSize pool_size = {0};
+    pool_size.type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+    pool_size.descriptorCount = _swap_chain.num_images;
+    VkDescriptorPoolCreateInfo descriptor_pool_ci = GetDescriptorPoolCI(_swap_chain.num_images, 1, &pool_size);
+    VK_CHECK(vkCreateDescriptorPool, _device, &descriptor_pool_ci, GetHostAllocator(), &_swap_chain.descriptor_pool);
+
+    VkDescriptorSetLayout* set_layouts = ArenaAlloc(&_frame_arena, sizeof(VkDescriptorSetLayout) * _swap_chain.num_images);
+    for(uint32_t i = 0; i < _swap_chain.num_images; i ++){
+        set_layouts[i] = _frame_set_layout;
+    }
+    VkDescriptorSetAllocateInfo descriptor_set_ai = GetDescriptorSetAI(
+        _swap_chain.descriptor_pool, _swap_chain.num_images, set_layouts
+    );
+    VK_CHECK(vkAllocateDescriptorSets, _device, &descriptor_set_ai, _swap_chain.descriptor_sets);
+
+    for(uint32_t i = 0; i < _swap_chain.num_images; i ++){
+        VkDescriptorBufferInfo buffer_info = {0};
+        buffer_info.buffer = _swap_chain.upload_ring.buffer;
+        buffer_info.offset = _swap_chain.upload_ring.partition_size * i;
+        buffer_info.range = sizeof(struct FrameUniforms);
+
+        VkWriteDescriptorSet write = {0};
+        write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        write.pNext = NULL;
+        write.dstSet = _swap_chain.descriptor_sets[i];
+        write.dstBinding = 0;
+        write.dstArrayElement = 0;
+        write.descriptorCount = 1;
+        write.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+        write.pBufferInfo = &buffer_info;
+        vkUpdateDescriptorSets(_device, 1, &write, 0, NULL);
+    }
+}
+
+void _FreeFrameUniforms(){
+    _RetireObject((struct Deletion){ .type = DELETION_DESCRIPTOR_POOL, .handle.descriptor_pool = _swap_chain.descriptor_pool });
+    RetireUploadRing(&_swap_chain.upload_ring, GetQueueTimelineLastSubmitted(&_graphics_timeline));
+}
+
+void _CreateTimestampQueries(){
+    if(!_gpu_timestamps) return;
+
+    VkQueryPoolCreateInfo query_pool_ci = GetQueryPoolCI(VK_QUERY_TYPE_TIMESTAMP, _swap_chain.num_images * 2);
+    VK_CHECK(vkCreateQueryPool, _device, &query_pool_ci, GetHostAllocator(), &_swap_chain.timestamp_pool);
+    memset(_swap_chain.timestamps_pending, 0, sizeof(_swap_chain.timestamps_pending));
+}
+
+void _FreeTimestampQueries(){
+    if(_swap_chain.timestamp_pool == NULL) return;
+
+    _RetireObject((struct Deletion){ .type = DELETION_QUERY_POOL, .handle.query_pool = _swap_chain.timestamp_pool });
+    _swap_chain.timestamp_pool = NULL;
+}
+
+void _CreateImageCommandBuffers(){
+    VkCommandBufferAllocateInfo command_buffer_ai = GetCommandBufferAI(
+        _command_pool, _swap_chain.num_images, VK_COMMAND_BUFFER_LEVEL_PRIMARY
+    );
+    VK_CHECK(vkAllocateCommandBuffers, _device, &command_buffer_ai, _swap_chain.command_buffers);
+
+    // Framebuffers and pipeline are new, so nothing recorded so far is valid
+    MARK_VREND_DIRTY();
+}
+
+void _FreeImageCommandBuffers(){
+    for(uint32_t i = 0; i < _swap_chain.num_images; i ++){
+        struct Deletion deletion = {
+            .type = DELETION_COMMAND_BUFFER, .command_pool = _command_pool, .handle.command_buffer = _swap_chain.command_buffers[i]
+        };
+        _RetireObject(deletion);
+    }
+}
+
+void _RecordFrame(VkCommandBuffer command_buffer, uint32_t image_index, VkCommandBufferUsageFlags flags, struct FrameData* frame){
+
+    Uint64 start = SDL_GetPerformanceCounter();
+
+    VkCommandBufferBeginInfo command_buffer_bi = GetCommandBufferBI(NULL, flags);
+    VK_CHECK_S(vkBeginCommandBuffer, command_buffer, &command_buffer_bi);
+
+    if(_swap_chain.timestamp_pool != NULL){
+        vkCmdResetQueryPool(command_buffer, _swap_chain.timestamp_pool, image_index * 2, 2);
+        vkCmdWriteTimestamp(command_buffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, _swap_chain.timestamp_pool, image_index * 2);
+    }
+
+    // The background is drawn from the frame uniforms, so the clear value never changes
+    VkClearValue clear_value = {0};
+    clear_value.color.float32[3] = 1.0f;
+
+    VkRenderPassBeginInfo render_pass_bi = GetRenderPassBI(
+        _render_pass, (VkOffset2D){0, 0}, _window_extent, _swap_chain.framebuffers[image_index],
+        1, &clear_value
+    );
+
+    // Secondary command buffers need a frame to own them, pre-recorded buffers are always inline
+    if(frame != NULL && _record_threads > 0){
+        vkCmdBeginRenderPass(command_buffer, &render_pass_bi, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+        _RecordSecondaries(command_buffer, image_index, frame);
+    } else {
+        vkCmdBeginRenderPass(command_buffer, &render_pass_bi, VK_SUBPASS_CONTENTS_INLINE);
+        _RecordDraws(command_buffer, image_index, 0, _GetNumDraws(), VK_TRUE);
+    }
+
+    vkCmdEndRenderPass(command_buffer);
+
+    if(_swap_chain.timestamp_pool != NULL){
+        vkCmdWriteTimestamp(command_buffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, _swap_chain.timestamp_pool, image_index * 2 + 1);
+    }
+
+    VK_CHECK_S(vkEndCommandBuffer, command_buffer);
+
+    double record_ms = (double)(SDL_GetPerformanceCounter() - start) / SDL_GetPerformanceFrequency() * 1000;
+    if(_record_stats.frames_recorded == 0){
+        _record_stats.record_ms = record_ms;
+    } else {
+        _record_stats.record_ms = _record_stats.record_ms * 0.9 + record_ms * 0.1;
+    }
+    _record_stats.frames_recorded += 1;
+}
+
+void _RecordSecondaries(VkCommandBuffer command_buffer, uint32_t image_index, struct FrameData* frame){
+
+    // One contiguous range of draws per thread
+    uint32_t num_draws = _GetNumDraws();
+    uint32_t num_tasks = _record_threads;
+    if(num_tasks > num_draws) num_tasks = num_draws;
+    if(num_tasks > MAX_RECORD_TASKS) num_tasks = MAX_RECORD_TASKS;
+
+    struct RecordTask tasks[MAX_RECORD_TASKS];
+    uint32_t first_draw = 0;
+    for(uint32_t i = 0; i < num_tasks; i ++){
+        uint32_t count = num_draws / num_tasks + (i < num_draws % num_tasks ? 1 : 0);
+        tasks[i].frame = frame;
+        tasks[i].image_index = image_index;
+        tasks[i].first_draw = first_draw;
+        tasks[i].num_draws = count;
+        tasks[i].background = i == 0;
+        tasks[i].command_buffer = NULL;
+        first_draw += count;
+    }
+
+    // The render thread records the first range itself instead of idling
+    struct JobCounter counter = {0};
+    for(uint32_t i = 1; i < num_tasks; i ++){
+        SubmitJob(_RecordTaskJob, &tasks[i], &counter);
+    }
+    _RecordTaskJob(&tasks[0], GetJobCallerIndex());
+    WaitJobCounter(&counter);
+
+    // Executed in task order so the result does not depend on scheduling
+    VkCommandBuffer secondaries[MAX_RECORD_TASKS];
+    for(uint32_t i = 0; i < num_tasks; i ++){
+        secondaries[i] = tasks[i].command_buffer;
+    }
+    vkCmdExecuteCommands(command_buffer, num_tasks, secondaries);
+}
+
+void _RecordTaskJob(void* data, uint32_t worker_index){
+    struct RecordTask* task = data;
+    struct WorkerCommands* worker = &task->frame->workers[worker_index];
+
+    if(worker->num_used == worker->num_allocated){
+        VkCommandBufferAllocateInfo command_buffer_ai = GetCommandBufferAI(
+            worker->pool, 1, VK_COMMAND_BUFFER_LEVEL_SECONDARY
+        );
+        VK_CHECK_S(vkAllocateCommandBuffers, _device, &command_buffer_ai, &worker->buffers[worker->num_allocated]);
+        worker->num_allocated += 1;
+    }
+    VkCommandBuffer command_buffer = worker->buffers[worker->num_used];
+    worker->num_used += 1;
+
+    VkCommandBufferInheritanceInfo inheritance_info = GetCommandBufferII(
+        _render_pass, 0, _swap_chain.framebuffers[task->image_index]
+    );
+    VkCommandBufferBeginInfo command_buffer_bi = GetCommandBufferBI(
+        &inheritance_info,
+        VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT | VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT
+    );
+    VK_CHECK_S(vkBeginCommandBuffer, command_buffer, &command_buffer_bi);
+    _RecordDraws(command_buffer, task->image_index, task->first_draw, task->num_draws, task->background);
+    VK_CHECK_S(vkEndCommandBuffer, command_buffer);
+
+    task->command_buffer = command_buffer;
+}
+
+void _RecordDraws(VkCommandBuffer command_buffer, uint32_t image_index, uint32_t first_draw, uint32_t num_draws, VkBool32 background){
+
+    if(_pipeline == NULL){
+        return;
+    }
+
+    // Secondary command buffers do not inherit bound state
+    vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, _pipeline);
+    vkCmdBindDescriptorSets(
+        command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, _pipeline_layout,
+        0, 1, &_swap_chain.descriptor_sets[image_index], 0, NULL
+    );
 
     VkViewport viewport = {
         .x = 0.0f,
@@ -552,7 +1741,6 @@ void _CreateGraphicsPipeline(){
         .minDepth = 0.0f,
         .maxDepth = 1.0f
     };
-
     VkRect2D scissor = {
         .offset = {
             .x = 0,
@@ -560,124 +1748,356 @@ void _CreateGraphicsPipeline(){
         },
         .extent = _window_extent
     };
+    vkCmdSetViewport(command_buffer, 0, 1, &viewport);
+    vkCmdSetScissor(command_buffer, 0, 1, &scissor);
 
-    VkPipelineVertexInputStateCreateInfo vertex_input_ci = GetVertexInputCI();
-    VkPipelineInputAssemblyStateCreateInfo input_assembly_ci = GetInputAssemblyCI(VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST);
-    VkPipelineRasterizationStateCreateInfo rasterization_ci = GetRasterizationCI(VK_POLYGON_MODE_FILL);
-    VkPipelineMultisampleStateCreateInfo multisample_ci = GetMultisampleCI();
-
-    VkPipelineColorBlendAttachmentState color_blend_attachment = GetColorBlendAttachmentState();
-
-    VkPipelineColorBlendStateCreateInfo color_blend_ci = {0};
-    color_blend_ci.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
-    color_blend_ci.pNext = NULL;
-    color_blend_ci.logicOpEnable = VK_FALSE;
-    color_blend_ci.logicOp = VK_LOGIC_OP_COPY;
-    color_blend_ci.attachmentCount = 1;
-    color_blend_ci.pAttachments = &color_blend_attachment;
-
-    VkPipelineViewportStateCreateInfo viewport_ci = {0};
-    viewport_ci.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
-    viewport_ci.pNext = NULL;
-    viewport_ci.viewportCount = 1;
-    viewport_ci.pViewports = &viewport;
-    viewport_ci.scissorCount = 1;
-    viewport_ci.pScissors = &scissor;
-
-    VkGraphicsPipelineCreateInfo pipeline_ci = {0};
-    pipeline_ci.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
-    pipeline_ci.pNext = NULL;
-    pipeline_ci.stageCount = 2;
-    pipeline_ci.pStages = shader_stages;
-    pipeline_ci.pVertexInputState = &vertex_input_ci;
-    pipeline_ci.pViewportState = &viewport_ci;
-    pipeline_ci.pRasterizationState = &rasterization_ci;
-    pipeline_ci.pMultisampleState = &multisample_ci;
-    pipeline_ci.pColorBlendState = &color_blend_ci;
-    pipeline_ci.pInputAssemblyState = &input_assembly_ci;
-    pipeline_ci.layout = _pipeline_layout;
-    pipeline_ci.renderPass = _render_pass;
-    pipeline_ci.subpass = 0;
-    pipeline_ci.basePipelineHandle = NULL;
-    
-    VK_CHECK(vkCreateGraphicsPipelines, _device, NULL, 1, &pipeline_ci, NULL, &_pipeline);
+    if(background){
+        vkCmdDraw(command_buffer, 3, 1, 0, 0);
+    }
 
-    vkDestroyShaderModule(_device, vert_shader_module, NULL);
-    vkDestroyShaderModule(_device, frag_shader_module, NULL);
+    // The instance index selects the grid cell in shader.vert
+    for(uint32_t i = first_draw; i < first_draw + num_draws; i ++){
+        vkCmdDraw(command_buffer, 3, 1, 3, i);
+    }
 }
 
-void _CreateFramebuffers(){
-    VkFramebufferCreateInfo framebuffer_ci = {0};
-    framebuffer_ci.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
-    framebuffer_ci.pNext = NULL;
-    framebuffer_ci.renderPass = _render_pass;
-    framebuffer_ci.attachmentCount = 1;
-    framebuffer_ci.width = _window_extent.width;
-    framebuffer_ci.height = _window_extent.height;
-    framebuffer_ci.layers = 1;
+void _ResetWorkerCommands(struct FrameData* frame){
+    for(uint32_t i = 0; i < GetJobSlotCount(); i ++){
+        if(frame->workers[i].num_used > 0){
+            VK_CHECK_S(vkResetCommandPool, _device, frame->workers[i].pool, 0);
+            frame->workers[i].num_used = 0;
+        }
+    }
+}
 
-    _swap_chain.framebuffers = malloc(sizeof(VkFramebuffer) * _swap_chain.num_images);
-    for(uint32_t i = 0; i < _swap_chain.num_images; i ++){
-        framebuffer_ci.pAttachments = &_swap_chain.image_views[i];
-        VK_CHECK(vkCreateFramebuffer, _device, &framebuffer_ci, NULL, &_swap_chain.framebuffers[i]);
+void _UpdatePresentStats(Uint64 start){
+    double present_ms = (double)(SDL_GetPerformanceCounter() - start) / SDL_GetPerformanceFrequency() * 1000;
+    if(_record_stats.present_ms == 0.0){
+        _record_stats.present_ms = present_ms;
+    } else {
+        _record_stats.present_ms = _record_stats.present_ms * 0.9 + present_ms * 0.1;
     }
 }
 
+void _ReadGpuTime(uint32_t image_index){
+    if(_swap_chain.timestamp_pool == NULL || !_swap_chain.timestamps_pending[image_index]) return;
+    _swap_chain.timestamps_pending[image_index] = VK_FALSE;
+
+    // The frame that wrote the queries has completed, so no need to wait
+    uint64_t timestamps[2] = {0};
+    VkResult result = vkGetQueryPoolResults(
+        _device, _swap_chain.timestamp_pool, image_index * 2, 2, sizeof(timestamps), timestamps,
+        sizeof(uint64_t), VK_QUERY_RESULT_64_BIT
+    );
+    if(result != VK_SUCCESS) return;
+
+    uint64_t mask = _physical_device.timestamp_valid_bits >= 64 ? UINT64_MAX : (1ULL << _physical_device.timestamp_valid_bits) - 1;
+    uint64_t ticks = (timestamps[1] - timestamps[0]) & mask;
+    double gpu_ms = ticks * (double)_physical_device.limits.timestampPeriod / 1000000.0;
+    if(_record_stats.gpu_ms == 0.0){
+        _record_stats.gpu_ms = gpu_ms;
+    } else {
+        _record_stats.gpu_ms = _record_stats.gpu_ms * 0.9 + gpu_ms * 0.1;
+    }
+}
+
+void _DelayFrameStart(Uint64 acquire_start, Uint64 acquire_end){
+
+    // Only FIFO modes hold frames for the display, elsewhere starting late just costs frame rate
+    VkPresentModeKHR mode = _swap_chain.present_mode;
+    int refresh_hz = GET_VREND_REFRESH_RATE();
+    if((mode != VK_PRESENT_MODE_FIFO_KHR && mode != VK_PRESENT_MODE_FIFO_RELAXED_KHR) || refresh_hz <= 0){
+        return;
+    }
+
+    double ticks_per_ms = (double)SDL_GetPerformanceFrequency() / 1000.0;
+    Uint64 period = (Uint64)(ticks_per_ms * 1000.0 / refresh_hz);
+
+    // A blocking acquire returns when the display releases an image, which is
+    // the best vblank estimate available. Otherwise predict it a period on.
+    if(acquire_end - acquire_start > (Uint64)(ticks_per_ms * 0.5) || _vblank_estimate == 0){
+        _vblank_estimate = acquire_end + period;
+    } else {
+        _vblank_estimate += period;
+        while(_vblank_estimate < acquire_end) _vblank_estimate += period;
+    }
+
+    double budget_ms = _record_stats.record_ms + _record_stats.gpu_ms + LOW_LATENCY_MARGIN_MS;
+    Uint64 budget = (Uint64)(budget_ms * ticks_per_ms);
+    if(budget >= _vblank_estimate - acquire_end) return;
+    Uint64 deadline = _vblank_estimate - budget;
+
+    // Coarse sleep, then spin the last millisecond
+    Uint64 now = SDL_GetPerformanceCounter();
+    while(now < deadline){
+        double remaining_ms = (double)(deadline - now) / ticks_per_ms;
+        if(remaining_ms > 2.0){
+            SDL_Delay((Uint32)(remaining_ms - 1.0));
+        }
+        now = SDL_GetPerformanceCounter();
+    }
+}
+
+void _StartPresentThread(){
+
+    // Without a second queue the present thread shares the graphics queue and has to lock it
+    InitPresentThread(_present_queue, _present_queue == _graphics_queue);
+}
+
+void SET_VREND_MEMORY_PRESSURE_CALLBACK(VrendMemoryPressureCallback callback, void* data){
+    _memory_callback = callback;
+    _memory_callback_data = data;
+}
+
+VkDeviceSize TRIM_VREND_CACHES(){
+
+    // Staging goes first so the block it leaves empty is released with the rest
+    TrimTransferStaging();
+    return TrimGpuMemory();
+}
+
+void GET_VREND_MEMORY_USAGE(struct VrendMemoryUsage* usage){
+    *usage = _memory_usage;
+}
+
+void POLL_VREND_MEMORY(){
+    Uint64 interval = SDL_GetPerformanceFrequency() / 1000 * VREND_MEMORY_BUDGET_IDLE_MS;
+    if(_device != NULL && SDL_GetPerformanceCounter() - _memory_budget_time >= interval){
+        _UpdateMemoryBudget();
+    }
+}
+
+void _UpdateMemoryBudget(){
+    _memory_budget_time = SDL_GetPerformanceCounter();
+    UpdateGpuMemoryBudget();
+    struct GpuHeapBudget heaps[VK_MAX_MEMORY_HEAPS];
+    uint32_t num_heaps = GetGpuHeapBudgets(heaps);
+
+    // The heap closest to its budget decides the level
+    double fraction = -1.0;
+    for(uint32_t i = 0; i < num_heaps; i ++){
+        if(heaps[i].budget == 0) continue;
+        double heap_fraction = (double)heaps[i].usage / heaps[i].budget;
+        if(heap_fraction > fraction){
+            fraction = heap_fraction;
+            _memory_usage.heap = i;
+            _memory_usage.usage = heaps[i].usage;
+            _memory_usage.budget = heaps[i].budget;
+        }
+    }
+    _memory_usage.driver_budget = IsGpuMemoryBudgetEnabled();
+
+    enum VrendMemoryPressure pressure = VREND_MEMORY_PRESSURE_NONE;
+    double critical = VREND_MEMORY_CRITICAL_WATER;
+    double high = VREND_MEMORY_HIGH_WATER;
+    if(_memory_usage.pressure >= VREND_MEMORY_PRESSURE_CRITICAL) critical -= VREND_MEMORY_HYSTERESIS;
+    if(_memory_usage.pressure >= VREND_MEMORY_PRESSURE_HIGH) high -= VREND_MEMORY_HYSTERESIS;
+    if(fraction >= critical){
+        pressure = VREND_MEMORY_PRESSURE_CRITICAL;
+    } else if(fraction >= high){
+        pressure = VREND_MEMORY_PRESSURE_HIGH;
+    }
+    if(pressure == _memory_usage.pressure) return;
+
+    _memory_usage.pressure = pressure;
+    _memory_usage.pressure_changes += 1;
+
+    if(pressure > VREND_MEMORY_PRESSURE_NONE){
+        fprintf(stderr, "WARNING: GPU heap %u is at %.0f%% of its budget\n", _memory_usage.heap, fraction * 100.0);
+    }
+    if(_memory_callback != NULL){
+        _memory_callback(&_memory_usage, _memory_callback_data);
+    } else {
+        _ApplyMemoryPolicy(&_memory_usage);
+    }
+}
+
+// Rendering goes straight to the swap chain, so there is no render
+// resolution to lower. Its images are the largest memory left besides the
+// caches, CRITICAL drops to the fewest the surface allows until it is left.
+void _ApplyMemoryPolicy(const struct VrendMemoryUsage* usage){
+    if(usage->pressure >= VREND_MEMORY_PRESSURE_HIGH){
+        TRIM_VREND_CACHES();
+    }
+    VkBool32 min_images = usage->pressure == VREND_MEMORY_PRESSURE_CRITICAL;
+    if(min_images != _pressure_min_images){
+        _pressure_min_images = min_images;
+        _swap_chain_stale = VK_TRUE;
+    }
+}
+
+uint32_t _GetNumDraws(){
+    return _grid_columns > 0 ? _grid_columns * _grid_rows : 1;
+}
+
 void DRAW_VREND(){
 
-    VK_CHECK_S(vkWaitForFences, _device, 1, &_render_fence, VK_TRUE, UINT64_MAX);
-    VK_CHECK_S(vkResetFences, _device, 1, &_render_fence);
+    // Nothing is submitted while hidden, the simulation still advances through STEP_VREND
+    if(GET_VREND_STATE() == VREND_STATE_HIDDEN){
+        return;
+    }
+
+    // Low latency mode runs render commands between acquire and submit, so
+    // changes to the frame slots and the swap chain wait for the next frame
+    if(_requested_frames_in_flight != 0){
+        _ResizeFrames(_requested_frames_in_flight);
+        _requested_frames_in_flight = 0;
+    }
+    if(_swap_chain_stale){
+        _CreateSwapChain();
+        if(_swap_chain_stale) return;
+    }
+
+    struct FrameData* frame = &_frames[_frame_counter % _num_frames_in_flight];
+
+    // Only blocks when the GPU is a full ring of frames behind. Low latency
+    // mode keeps at most one frame queued, whatever the ring size.
+    if(_low_latency){
+        WaitQueueTimeline(_device, &_graphics_timeline, GetQueueTimelineLastSubmitted(&_graphics_timeline));
+    } else {
+        WaitQueueTimeline(_device, &_graphics_timeline, frame->timeline_value);
+    }
+
+    // The render semaphore is signaled again below, so the present waiting on it must have been issued
+    WaitPresentSubmitted(frame->present_id);
+
+    // Frame boundary, nothing from the frame arena outlives the frame that allocated it.
+    // Once the arena has grown to fit a frame this never reaches the heap again.
+    ResetArena(&_frame_arena);
+    if(GetArenaBlockAllocations() != _arena_block_allocations){
+        _arena_block_allocations = GetArenaBlockAllocations();
+        _arena_frames += 1;
+        _last_arena_frame = _frame_counter;
+    }
+
+    CollectDeletions();
+    _UpdateShaderReload();
+    PumpTransfers();
+
+    // Uploads bring staging back under pressure, it goes again once they are done
+    if(_memory_callback == NULL && _memory_usage.pressure >= VREND_MEMORY_PRESSURE_HIGH && TrimTransferStaging() > 0){
+        TrimGpuMemory();
+    }
+    if(_frame_counter % VREND_MEMORY_BUDGET_INTERVAL == 0){
+        _UpdateMemoryBudget();
+    }
+
+    VkResult present_result = TakePresentResult();
+    if(present_result == VK_ERROR_OUT_OF_DATE_KHR || present_result == VK_SUBOPTIMAL_KHR){
+        _CreateSwapChain();
+        return;
+    }
 
     uint32_t image_index;
     VkResult result;
-    result = vkAcquireNextImageKHR(_device, _swap_chain.handle, UINT64_MAX, _present_semaphore, NULL, &image_index);
+    Uint64 acquire_start = SDL_GetPerformanceCounter();
+    result = vkAcquireNextImageKHR(_device, _swap_chain.handle, UINT64_MAX, frame->present_semaphore, NULL, &image_index);
     if(result == VK_ERROR_OUT_OF_DATE_KHR){
         _CreateSwapChain();
         return;
     }
 
-    VK_CHECK_S(vkResetCommandBuffer, _command_buffer, 0);
+    // The image may still be used by another frame if images are returned out of order
+    WaitQueueTimeline(_device, &_graphics_timeline, _swap_chain.images_in_flight[image_index]);
+    _ReadGpuTime(image_index);
 
-    VkCommandBufferBeginInfo command_buffer_bi = GetCommandBufferBI(
-        NULL, VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT
+    // Sample input as late as the measured frame cost allows. Input commands
+    // queued for the render thread are applied here instead of before acquire.
+    if(_low_latency){
+        _DelayFrameStart(acquire_start, SDL_GetPerformanceCounter());
+        if(IsRenderThread()){
+            RunRenderCommands();
+        }
+    }
+    Uint64 input_time = _pending_input_time;
+    _pending_input_time = 0;
+
+    // Per frame values only ever go through the uniforms. Being the first
+    // allocation of the partition they land where the descriptor set points.
+    BeginUploadPartition(&_swap_chain.upload_ring, image_index);
+    struct UploadAllocation upload = {0};
+    AllocateUpload(
+        &_swap_chain.upload_ring, sizeof(struct FrameUniforms),
+        _physical_device.limits.minUniformBufferOffsetAlignment, &upload
     );
-    VK_CHECK_S(vkBeginCommandBuffer, _command_buffer, &command_buffer_bi);
+    float flash = fabs(sin(_sim_time * 0.5));
+    struct FrameUniforms* uniforms = upload.data;
+    uniforms->clear_color[0] = 0.0f;
+    uniforms->clear_color[1] = 0.0f;
+    uniforms->clear_color[2] = flash;
+    uniforms->clear_color[3] = 1.0f;
+    uniforms->grid[0] = _grid_columns;
+    uniforms->grid[1] = _grid_rows;
+
+    // Draws are skipped until the pipeline is compiled instead of stalling the
+    // frame. Pre-recorded buffers without them are recorded again once it is.
+    if(_pipeline == NULL){
+        if(_UpdatePipeline(VK_FALSE)){
+            MARK_VREND_DIRTY();
+        } else {
+            _record_stats.frames_skipped += 1;
+        }
+    }
 
-    VkClearValue clear_value = {0};
-    float flash = fabs(sin(_frame_counter / 120.0f));
-    clear_value.color.float32[0] = 0.0f;
-    clear_value.color.float32[1] = 0.0f;
-    clear_value.color.float32[2] = flash;
-    clear_value.color.float32[3] = 1.0f;
+    VkCommandBuffer command_buffer;
+    if(_prerecord){
+        command_buffer = _swap_chain.command_buffers[image_index];
+        if(_swap_chain.dirty[image_index]){
+            _RecordFrame(command_buffer, image_index, 0, NULL);
+            _swap_chain.dirty[image_index] = VK_FALSE;
+        } else {
+            _record_stats.frames_reused += 1;
+            _record_stats.saved_ms += _record_stats.record_ms;
+        }
+    } else {
+        command_buffer = frame->command_buffer;
+        VK_CHECK_S(vkResetCommandBuffer, command_buffer, 0);
+        _ResetWorkerCommands(frame);
+        _RecordFrame(command_buffer, image_index, VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT, frame);
+    }
 
-    VkRenderPassBeginInfo render_pass_bi = GetRenderPassBI(
-        _render_pass, (VkOffset2D){0, 0}, _window_extent, _swap_chain.framebuffers[image_index],
-        1, &clear_value
+    // Uploads finished on the transfer queue are acquired ahead of the frame
+    VkCommandBuffer command_buffers[MAX_TRANSFER_BATCHES + 1];
+    struct TimelineWait transfer_wait = {0};
+    uint32_t num_command_buffers = TakeTransferAcquires(command_buffers, &transfer_wait);
+    command_buffers[num_command_buffers] = command_buffer;
+    num_command_buffers += 1;
+
+    FinishUploadPartition(&_swap_chain.upload_ring);
+    LockPresentQueue();
+    frame->timeline_value = SubmitQueueTimeline(
+        &_graphics_timeline, num_command_buffers, command_buffers,
+        transfer_wait.timeline != NULL ? 1 : 0, &transfer_wait,
+        frame->present_semaphore, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+        frame->render_semaphore
     );
+    UnlockPresentQueue();
+    _RetireSwapChains(frame->timeline_value);
+    _swap_chain.images_in_flight[image_index] = frame->timeline_value;
+    _redraw_requested = VK_FALSE;
+    if(_record_stats.first_frame_ms == 0.0){
+        _record_stats.first_frame_ms = (double)(SDL_GetPerformanceCounter() - _init_start) / SDL_GetPerformanceFrequency() * 1000;
+    }
+    if(_reload_swapped){
+        _reload_swapped = VK_FALSE;
+        _record_stats.shader_reloads += 1;
+        _record_stats.reload_ms = (double)(SDL_GetPerformanceCounter() - _reload_saved_time) / SDL_GetPerformanceFrequency() * 1000;
+        printf("Shader reload: %.1f ms from save to first frame\n", _record_stats.reload_ms);
+    }
+    if(_swap_chain.timestamp_pool != NULL){
+        _swap_chain.timestamps_pending[image_index] = VK_TRUE;
+    }
 
-    vkCmdBeginRenderPass(_command_buffer, &render_pass_bi, VK_SUBPASS_CONTENTS_INLINE);
-
-    vkCmdBindPipeline(_command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, _pipeline);
-    vkCmdDraw(_command_buffer, 3, 1, 0, 0);
-
-    vkCmdEndRenderPass(_command_buffer);
-
-    VK_CHECK_S(vkEndCommandBuffer, _command_buffer);
-
-    VkSubmitInfo submit = {0};
-    submit.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-    submit.pNext = NULL;
-    
-    VkPipelineStageFlags wait_stage = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-    submit.pWaitDstStageMask = &wait_stage;
-    submit.waitSemaphoreCount = 1;
-    submit.pWaitSemaphores = &_present_semaphore;
-    submit.signalSemaphoreCount = 1;
-    submit.pSignalSemaphores = &_render_semaphore;
-    submit.commandBufferCount = 1;
-    submit.pCommandBuffers = &_command_buffer;
+    Uint64 present_start = SDL_GetPerformanceCounter();
 
-    VK_CHECK_S(vkQueueSubmit, _graphics_queue, 1, &submit, _render_fence);
+    // Hand the image off and go straight back to recording the next frame
+    if(IsPresentThreadRunning()){
+        struct PresentRequest request = { _swap_chain.handle, image_index, frame->render_semaphore, input_time };
+        frame->present_id = QueuePresent(&request);
+        _frame_counter += 1;
+        _UpdatePresentStats(present_start);
+        return;
+    }
 
     VkPresentInfoKHR present_info = {0};
     present_info.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
@@ -685,16 +2105,21 @@ void DRAW_VREND(){
     present_info.swapchainCount = 1;
     present_info.pSwapchains = &_swap_chain.handle;
     present_info.waitSemaphoreCount = 1;
-    present_info.pWaitSemaphores = &_render_semaphore;
+    present_info.pWaitSemaphores = &frame->render_semaphore;
     present_info.pImageIndices = &image_index;
 
-    result = vkQueuePresentKHR(_graphics_queue, &present_info);
+    // The frame was submitted, so move on to the next slot even if the swap chain is stale
+    _frame_counter += 1;
+
+    result = vkQueuePresentKHR(_present_queue, &present_info);
+    _UpdatePresentStats(present_start);
+    if(input_time != 0){
+        RecordInputToPresent(input_time, SDL_GetPerformanceCounter());
+    }
     if(result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR){
         _CreateSwapChain();
         return;
     }
-
-    _frame_counter += 1;
 }
 
 VkBool32 _CheckInstanceExtensions(){
@@ -702,13 +2127,13 @@ VkBool32 _CheckInstanceExtensions(){
     // Get the needed extensions for the platform (SDL2)
     uint32_t num_needed_extensions = 0;
     SDL_Vulkan_GetInstanceExtensions(_window, &num_needed_extensions, NULL);
-    const char** needed_extensions = malloc(sizeof(char*) * num_needed_extensions);
+    const char** needed_extensions = ArenaAlloc(&_frame_arena, sizeof(char*) * num_needed_extensions);
     SDL_Vulkan_GetInstanceExtensions(_window, &num_needed_extensions, needed_extensions);
 
     // Get the available extensions from system
     uint32_t num_extensions = 0;
     vkEnumerateInstanceExtensionProperties(NULL, &num_extensions, NULL);
-    VkExtensionProperties* extensions = malloc(sizeof(VkExtensionProperties) * num_extensions);
+    VkExtensionProperties* extensions = ArenaAlloc(&_frame_arena, sizeof(VkExtensionProperties) * num_extensions);
     vkEnumerateInstanceExtensionProperties(NULL, &num_extensions, extensions);
 
     // Determine if the needed extensions are available
@@ -729,24 +2154,32 @@ VkBool32 _CheckInstanceExtensions(){
         }
     }
 
-    free(needed_extensions);
-    free(extensions);
     return has_required;
 }
 
 void _SetPhysicalDevice(VkPhysicalDevice device){
     _physical_device.handle = device;
-    _physical_device.num_queues = 2;
     
     uint32_t num_queues = 0;
     vkGetPhysicalDeviceQueueFamilyProperties(device, &num_queues, NULL);
-    VkQueueFamilyProperties* queue_properties = malloc(sizeof(VkQueueFamilyProperties) * num_queues);
+    VkQueueFamilyProperties* queue_properties = ArenaAlloc(&_frame_arena, sizeof(VkQueueFamilyProperties) * num_queues);
     vkGetPhysicalDeviceQueueFamilyProperties(device, &num_queues, queue_properties);
 
+    VkBool32 has_transfer_family = VK_FALSE;
     for(uint32_t i = 0; i < num_queues; i ++){
         VkQueueFlags flags = queue_properties[i].queueFlags;
+
+        // Transfer only families are the copy engines, which run alongside graphics
+        if((flags & VK_QUEUE_TRANSFER_BIT) && !(flags & (VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT))){
+            _physical_device.transfer_queue_index = i;
+            _physical_device.transfer_granularity = queue_properties[i].minImageTransferGranularity;
+            has_transfer_family = VK_TRUE;
+        }
+
         if((flags & VK_QUEUE_GRAPHICS_BIT) == VK_QUEUE_GRAPHICS_BIT){
             _physical_device.graphics_queue_index = i;
+            _physical_device.graphics_queue_count = queue_properties[i].queueCount;
+            _physical_device.timestamp_valid_bits = queue_properties[i].timestampValidBits;
         }
 
         VkBool32 has_present_family = VK_FALSE;
@@ -756,11 +2189,42 @@ void _SetPhysicalDevice(VkPhysicalDevice device){
         }
     }
 
-    free(queue_properties);
+    if(_physical_device.graphics_queue_index == _physical_device.present_queue_index){
+        _physical_device.num_queues = 1;
+    } else {
+        _physical_device.num_queues = 2;
+    }
+
+    // A family may only be created once, so one that also presents is left to presents
+    if(!has_transfer_family || _physical_device.transfer_queue_index == _physical_device.present_queue_index){
+        _physical_device.transfer_queue_index = _physical_device.graphics_queue_index;
+        _physical_device.transfer_granularity = (VkExtent3D){ 1, 1, 1 };
+    }
 
     vkGetPhysicalDeviceProperties(device, &_physical_device.properties);
+    _physical_device.limits = _physical_device.properties.limits;
     vkGetPhysicalDeviceMemoryProperties(device, &_physical_device.mem_properties);
     vkGetPhysicalDeviceFeatures(device, &_physical_device.features);
+
+    _physical_device.features12 = (VkPhysicalDeviceVulkan12Features){0};
+    _physical_device.features12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+    VkPhysicalDeviceFeatures2 features2 = {0};
+    features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+    features2.pNext = &_physical_device.features12;
+    vkGetPhysicalDeviceFeatures2(device, &features2);
+    _physical_device.features12.pNext = NULL;
+
+    uint32_t num_extensions = 0;
+    vkEnumerateDeviceExtensionProperties(device, NULL, &num_extensions, NULL);
+    VkExtensionProperties* extensions = ArenaAlloc(&_frame_arena, sizeof(VkExtensionProperties) * num_extensions);
+    vkEnumerateDeviceExtensionProperties(device, NULL, &num_extensions, extensions);
+    _physical_device.memory_budget = VK_FALSE;
+    for(uint32_t i = 0; i < num_extensions; i ++){
+        if(strcmp(extensions[i].extensionName, VK_EXT_MEMORY_BUDGET_EXTENSION_NAME) == 0){
+            _physical_device.memory_budget = VK_TRUE;
+        }
+    }
+
     vkGetPhysicalDeviceSurfaceCapabilitiesKHR(device, _surface, &_physical_device.capabilities);
 
     _window_extent = _physical_device.capabilities.currentExtent;
@@ -768,7 +2232,7 @@ void _SetPhysicalDevice(VkPhysicalDevice device){
     vkGetPhysicalDeviceSurfaceFormatsKHR(
         device, _surface, &_physical_device.num_formats, NULL
     );
-    _physical_device.formats = malloc(sizeof(VkSurfaceFormatKHR) * _physical_device.num_formats);
+    _physical_device.formats = ArenaAlloc(&_init_arena, sizeof(VkSurfaceFormatKHR) * _physical_device.num_formats);
     vkGetPhysicalDeviceSurfaceFormatsKHR(
         device, _surface, &_physical_device.num_formats, _physical_device.formats
     );
@@ -776,43 +2240,12 @@ void _SetPhysicalDevice(VkPhysicalDevice device){
     vkGetPhysicalDeviceSurfacePresentModesKHR(
         device, _surface, &_physical_device.num_present_modes, NULL
     );
-    free(_physical_device.present_modes);
-    _physical_device.present_modes = malloc(sizeof(VkPresentModeKHR) * _physical_device.num_present_modes);
+    _physical_device.present_modes = ArenaAlloc(&_init_arena, sizeof(VkPresentModeKHR) * _physical_device.num_present_modes);
     vkGetPhysicalDeviceSurfacePresentModesKHR(
         device, _surface, &_physical_device.num_present_modes, _physical_device.present_modes
     );
 }
 
-void _LoadShaderModule(char* path, VkShaderModule* module){
-    
-    FILE* file = fopen(path, "rb");
-    if(file == NULL){
-        fprintf(stderr, "ERROR: failed to open shader file %s\n", path);
-        exit(EXIT_FAILURE);
-    }
-
-    fseek(file, 0, SEEK_END);
-    long size = ftell(file);
-    rewind(file);
-
-    char* shader_code = malloc(sizeof(char) * size);
-    fread(shader_code, size, sizeof(char), file);
-
-    fclose(file);
-
-    VkShaderModuleCreateInfo module_ci = {0};
-    module_ci.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-    module_ci.pNext = NULL;
-    module_ci.flags = 0;
-    module_ci.codeSize = size;
-    module_ci.pCode = (uint32_t*)shader_code;
-
-    VkShaderModule temp_module = NULL;
-    VK_CHECK(vkCreateShaderModule, _device, &module_ci, NULL, &temp_module);
-
-    *module = temp_module;
-}
-
 void CHECK(VkResult result, char* fname, VkBool32 print){
 
     #ifdef DEBUG
@@ -25,8 +25,181 @@
 // Silent check result from Vulkan function. Only prints on exit.
 #define VK_CHECK_S(fname, ...) CHECK(fname(__VA_ARGS__), STR(fname), VK_FALSE);
 
+void CHECK(VkResult result, char* fname, VkBool32 print);
+
+// Number of frames the CPU may record ahead of the GPU
+#define MAX_FRAMES_IN_FLIGHT 3
+#define DEFAULT_FRAMES_IN_FLIGHT 2
+
+// Upper bound on secondary command buffers per frame
+#define MAX_RECORD_TASKS 64
+
+// Per image resources live in fixed arrays so recreating the swap chain never allocates
+#define MAX_SWAP_CHAIN_IMAGES 8
+
+struct VrendRecordStats {
+    uint64_t                                frames_recorded;
+    uint64_t                                frames_reused;          // Pre-recorded command buffer submitted as is
+    double                                  record_ms;              // Moving average CPU time to record a frame
+    double                                  saved_ms;               // Recording time skipped by reuse
+    double                                  present_ms;             // Moving average time the render thread spends presenting
+    double                                  gpu_ms;                 // Moving average GPU time per frame from timestamps
+    uint64_t                                swap_chain_recreations;
+    double                                  recreate_ms;            // CPU time of the last swap chain creation
+    VkBool32                                pipeline_cache_warm;    // Pipeline cache was loaded from disk
+    uint64_t                                frames_skipped;         // Drawn with only the clear while the pipeline compiles
+    double                                  init_ms;                // INIT_VREND start to end
+    double                                  first_frame_ms;         // INIT_VREND start to the first submitted frame
+    uint64_t                                shader_reloads;
+    double                                  reload_ms;              // Last shader save to the first frame submitted with it
+};
+
 void INIT_VREND(char* title, uint32_t w, uint32_t h);
 void FREE_VREND();
 void DRAW_VREND();
 
+// Must be called before INIT_VREND. The cache is loaded in INIT_VREND and
+// saved in FREE_VREND, NULL disables it. path is not copied.
+void SET_VREND_PIPELINE_CACHE_PATH(const char* path);
+
+// Must be called before INIT_VREND. Loads dir/vert.spv and dir/frag.spv
+// instead of the shaders embedded at build time, for shader development.
+// Changes to shader.vert and shader.frag in dir are compiled and swapped in
+// while running. NULL, the default, uses the embedded ones. dir is not copied.
+void SET_VREND_SHADER_DIR(const char* dir);
+
+// Must be called before INIT_VREND. Passes instrumented allocation
+// callbacks to every Vulkan object so driver host allocations are counted
+// per allocation scope in PRINT_VREND_STATS.
+void SET_VREND_HOST_ALLOCATOR(VkBool32 enable);
+
+// Can be called before or after INIT_VREND. Clamped to [1, MAX_FRAMES_IN_FLIGHT],
+// after INIT_VREND it takes effect with the next frame.
+void SET_VREND_FRAMES_IN_FLIGHT(uint32_t count);
+
+// Picks MAILBOX when available, FIFO otherwise
+#define VREND_PRESENT_MODE_AUTO VK_PRESENT_MODE_MAX_ENUM_KHR
+
+// Both can be called before or after INIT_VREND and recreate the swap chain
+// with the next frame when changed. Unsupported modes fall back to FIFO. An
+// image count of 0 picks minImageCount + 1, others are clamped to what the
+// surface allows and to MAX_SWAP_CHAIN_IMAGES.
+void SET_VREND_PRESENT_MODE(VkPresentModeKHR present_mode);
+void SET_VREND_SWAP_CHAIN_IMAGES(uint32_t count);
+uint32_t GET_VREND_SWAP_CHAIN_IMAGES();
+
+VkPresentModeKHR GET_VREND_PRESENT_MODE();
+
+// Refresh rate of the display the window is on, 0 if unknown. QUERY asks
+// SDL and must run on the main thread, which hands the result to the
+// renderer with SET. GET returns the cached value and is safe to call
+// every frame from the thread that draws.
+int QUERY_VREND_REFRESH_RATE();
+void SET_VREND_REFRESH_RATE(int refresh_hz);
+int GET_VREND_REFRESH_RATE();
+
+// Pre-recorded mode records one command buffer per framebuffer and only
+// records it again once marked dirty. Per frame values go through uniforms.
+void SET_VREND_PRERECORD(VkBool32 enable);
+
+// Presents from a dedicated thread on the present queue instead of inline.
+// Acquire stays on the calling thread since recording needs the image index.
+void SET_VREND_ASYNC_PRESENT(VkBool32 enable);
+
+// Keeps at most one frame queued and, under FIFO, delays input sampling and
+// recording until the measured CPU and GPU frame time before the next vblank.
+// Late input sampling needs the render thread.
+void SET_VREND_LOW_LATENCY(VkBool32 enable);
+
+// Input sampled at timestamp (SDL_GetPerformanceCounter) has been applied.
+// Its input to present latency is reported with the next frame.
+void MARK_VREND_INPUT(Uint64 timestamp);
+void MARK_VREND_DIRTY();
+void GET_VREND_RECORD_STATS(struct VrendRecordStats* stats);
+
+// 0 records inline on the calling thread. Otherwise draws are split into
+// ranges recorded into secondary command buffers by that many threads,
+// the calling thread included. Clamped to the job pool size after INIT_VREND.
+void SET_VREND_RECORD_THREADS(uint32_t count);
+
+// Draws the triangle once per cell of a columns x rows grid, 0 x 0 draws it once
+void SET_VREND_GRID(uint32_t columns, uint32_t rows);
+
+// Records num_frames frames without submitting them for every thread count
+// and prints the time per frame
+void BENCH_VREND_RECORDING(uint32_t num_frames);
+
+// Times vkAllocateMemory against the sub-allocator for the same sizes
+void BENCH_VREND_MEMORY(uint32_t num_allocations);
+
+// Uploads a buffer of that many MiB while drawing and prints the throughput
+// and the slowest frame during the upload
+void BENCH_VREND_UPLOAD(uint32_t megabytes);
+void PRINT_VREND_STATS();
+
+enum VrendState {
+    VREND_STATE_ACTIVE,                                             // A frame is wanted
+    VREND_STATE_IDLE,                                               // On demand and nothing changed
+    VREND_STATE_HIDDEN                                              // Minimized or occluded, nothing is submitted
+};
+
+// Driven by window events. DRAW_VREND does nothing while hidden.
+void SET_VREND_VISIBLE(VkBool32 visible);
+
+// On demand mode only wants a frame after REQUEST_VREND_REDRAW. Simulation
+// steps, view changes and MARK_VREND_DIRTY request one.
+void SET_VREND_ON_DEMAND(VkBool32 enable);
+void REQUEST_VREND_REDRAW();
+
+// Advances the simulation, also while hidden or idle. Paused simulations do not change the view.
+void STEP_VREND(double seconds);
+void PAUSE_VREND(VkBool32 pause);
+VkBool32 IS_VREND_PAUSED();
+enum VrendState GET_VREND_STATE();
+
+// Fraction of a heap's budget in use at which each pressure level starts.
+// A level is left once usage falls VREND_MEMORY_HYSTERESIS below it.
+#define VREND_MEMORY_HIGH_WATER 0.80
+#define VREND_MEMORY_CRITICAL_WATER 0.95
+#define VREND_MEMORY_HYSTERESIS 0.05
+
+// Frames between budget queries, and milliseconds between them while no
+// frames are drawn
+#define VREND_MEMORY_BUDGET_INTERVAL 30
+#define VREND_MEMORY_BUDGET_IDLE_MS 500
+
+enum VrendMemoryPressure {
+    VREND_MEMORY_PRESSURE_NONE,
+    VREND_MEMORY_PRESSURE_HIGH,                                     // Optional caches should go
+    VREND_MEMORY_PRESSURE_CRITICAL                                  // Quality should drop before allocations fail
+};
+
+// Of the heap closest to its budget
+struct VrendMemoryUsage {
+    VkBool32                                driver_budget;          // From VK_EXT_memory_budget, else only our own blocks against a share of the heap
+    enum VrendMemoryPressure                pressure;
+    uint32_t                                heap;
+    VkDeviceSize                            usage;
+    VkDeviceSize                            budget;
+    uint64_t                                pressure_changes;
+};
+
+// Called on the thread that draws whenever the pressure level changes, in
+// place of the default policy. The default trims caches from HIGH on, again
+// whenever uploads have drained, and uses the fewest swap chain images the
+// surface allows while CRITICAL without changing the requested count. NULL
+// restores the default.
+typedef void (*VrendMemoryPressureCallback)(const struct VrendMemoryUsage* usage, void* data);
+void SET_VREND_MEMORY_PRESSURE_CALLBACK(VrendMemoryPressureCallback callback, void* data);
+
+// Releases GPU memory only kept for speed, currently the upload staging
+// ring and empty memory blocks. Returns the bytes given back to the driver.
+VkDeviceSize TRIM_VREND_CACHES();
+void GET_VREND_MEMORY_USAGE(struct VrendMemoryUsage* usage);
+
+// Queries the budget if VREND_MEMORY_BUDGET_IDLE_MS passed since the last
+// query, for while DRAW_VREND is not called because the window is hidden
+// or idle
+void POLL_VREND_MEMORY();
+
 #endif
\ No newline at end of file
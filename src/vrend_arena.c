@@ -0,0 +1,86 @@
+#include "vrend_arena.h"
+
+struct ArenaBlock {
+    struct ArenaBlock*                      next;
+    size_t                                  size;                   // Usable bytes after the header
+    size_t                                  head;                   // Next free byte
+};
+
+// Header rounded up so the first allocation of a block is aligned
+#define ARENA_HEADER_SIZE ((sizeof(struct ArenaBlock) + ARENA_ALIGNMENT - 1) & ~(size_t)(ARENA_ALIGNMENT - 1))
+
+static uint64_t                         _block_allocations = 0;
+
+struct ArenaBlock* _NewArenaBlock(struct Arena* arena, size_t size);
+
+void InitArena(struct Arena* arena, size_t block_size){
+    memset(arena, 0, sizeof(struct Arena));
+    arena->block_size = block_size > 0 ? block_size : DEFAULT_ARENA_BLOCK_SIZE;
+}
+
+void FreeArena(struct Arena* arena){
+    struct ArenaBlock* block = arena->blocks;
+    while(block != NULL){
+        struct ArenaBlock* next = block->next;
+        free(block);
+        block = next;
+    }
+    arena->blocks = NULL;
+    arena->used = 0;
+    arena->capacity = 0;
+}
+
+void* ArenaAlloc(struct Arena* arena, size_t size){
+    size = (size + ARENA_ALIGNMENT - 1) & ~(size_t)(ARENA_ALIGNMENT - 1);
+
+    struct ArenaBlock* block = arena->blocks;
+    if(block == NULL || block->head + size > block->size){
+        // Blocks are malloc'd so earlier allocations never move
+        block = _NewArenaBlock(arena, size > arena->block_size ? size : arena->block_size);
+    }
+
+    void* data = (uint8_t*)block + ARENA_HEADER_SIZE + block->head;
+    block->head += size;
+    arena->used += size;
+    if(arena->used > arena->peak_bytes) arena->peak_bytes = arena->used;
+    return data;
+}
+
+void* ArenaCalloc(struct Arena* arena, size_t count, size_t size){
+    void* data = ArenaAlloc(arena, count * size);
+    memset(data, 0, count * size);
+    return data;
+}
+
+void ResetArena(struct Arena* arena){
+    if(arena->blocks != NULL && arena->blocks->next != NULL){
+        size_t capacity = arena->capacity;
+        FreeArena(arena);
+        arena->block_size = capacity;
+        _NewArenaBlock(arena, capacity);
+    }
+    if(arena->blocks != NULL){
+        arena->blocks->head = 0;
+    }
+    arena->used = 0;
+}
+
+uint64_t GetArenaBlockAllocations(){
+    return _block_allocations;
+}
+
+struct ArenaBlock* _NewArenaBlock(struct Arena* arena, size_t size){
+    struct ArenaBlock* block = malloc(ARENA_HEADER_SIZE + size);
+    if(block == NULL){
+        fprintf(stderr, "ERROR: failed to allocate %zu byte arena block\n", size);
+        exit(EXIT_FAILURE);
+    }
+    block->next = arena->blocks;
+    block->size = size;
+    block->head = 0;
+    arena->blocks = block;
+    arena->capacity += size;
+    arena->block_allocations += 1;
+    _block_allocations += 1;
+    return block;
+}
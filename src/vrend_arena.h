@@ -0,0 +1,44 @@
+#ifndef _VREND_ARENA_H_
+#define _VREND_ARENA_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#define DEFAULT_ARENA_BLOCK_SIZE (64 * 1024)
+#define ARENA_ALIGNMENT 16
+
+struct ArenaBlock;
+
+// Linear allocator over a chain of heap blocks. Allocations are only
+// released all at once by ResetArena. Not thread safe, each arena belongs
+// to one thread.
+struct Arena {
+    struct ArenaBlock*                      blocks;                 // Block being filled first
+    size_t                                  block_size;             // Of the next block taken from the heap
+    size_t                                  used;                   // Bytes handed out since the last reset
+    size_t                                  capacity;               // Bytes in every block
+    size_t                                  peak_bytes;             // Most bytes used between two resets
+    uint64_t                                block_allocations;      // Blocks taken from the heap
+};
+
+void InitArena(struct Arena* arena, size_t block_size);
+
+// Frees every block, everything allocated from the arena is invalid after
+void FreeArena(struct Arena* arena);
+
+// Aligned to ARENA_ALIGNMENT and uninitialised. Never returns NULL.
+void* ArenaAlloc(struct Arena* arena, size_t size);
+void* ArenaCalloc(struct Arena* arena, size_t count, size_t size);
+
+// Releases every allocation. An arena that had to chain blocks since the
+// last reset swaps them for one block of the whole capacity, so repeating
+// the same allocations afterwards never reaches the heap.
+void ResetArena(struct Arena* arena);
+
+// Blocks taken from the heap by every arena. Only counts arena growth,
+// allocations made elsewhere are not seen here.
+uint64_t GetArenaBlockAllocations();
+
+#endif
@@ -1,4 +1,5 @@
 #include "vrend_debug.h"
+#include "vrend_host_alloc.h"
 
 #define NUM_NEEDED_LAYERS 1
 static const char* _needed_layers[NUM_NEEDED_LAYERS] = {
@@ -67,7 +68,7 @@ void InitDebugUtils(VkInstance* vk_instance){
     );
 
     VkResult result;
-    result = _CreateDebugUtilsMessengerEXT(*vk_instance, &_debug_messenger_ci, NULL, &_debug_messenger);
+    result = _CreateDebugUtilsMessengerEXT(*vk_instance, &_debug_messenger_ci, GetHostAllocator(), &_debug_messenger);
     if(result != VK_SUCCESS){
         fprintf(stderr, "VK ERROR %d: failed to create debug utils messenger\n", result);
         exit(EXIT_FAILURE);
@@ -75,7 +76,7 @@ void InitDebugUtils(VkInstance* vk_instance){
 }
 
 void FreeDebugUtils(VkInstance* vk_instance){
-    _DestroyDebugUtilsMessengerEXT(*vk_instance, _debug_messenger, NULL);
+    _DestroyDebugUtilsMessengerEXT(*vk_instance, _debug_messenger, GetHostAllocator());
 }
 
 VKAPI_ATTR VkBool32 VKAPI_CALL _DebugCallback(
@@ -0,0 +1,130 @@
+#include "vrend.h"
+#include "vrend_deletion.h"
+#include "vrend_host_alloc.h"
+
+struct PendingDeletion {
+    struct Deletion                         deletion;
+    uint64_t                                timeline_value;
+};
+
+static VkDevice                         _device = NULL;
+static struct QueueTimeline*            _timeline = NULL;
+static struct PendingDeletion*          _pending = NULL;            // Ordered by timeline value
+static uint32_t                         _pending_head = 0;
+static uint32_t                         _pending_count = 0;
+static uint32_t                         _pending_capacity = 0;
+
+void _Destroy(struct Deletion* deletion);
+
+void InitDeletionQueue(VkDevice device, struct QueueTimeline* timeline){
+    _device = device;
+    _timeline = timeline;
+    _pending_head = 0;
+    _pending_count = 0;
+}
+
+void FreeDeletionQueue(){
+
+    // Values past the last submission will never be signaled, but once every
+    // submission has completed nothing can be in use anymore
+    WaitQueueTimeline(_device, _timeline, GetQueueTimelineLastSubmitted(_timeline));
+    for(uint32_t i = 0; i < _pending_count; i ++){
+        _Destroy(&_pending[_pending_head + i].deletion);
+    }
+    _pending_head = 0;
+    _pending_count = 0;
+    free(_pending);
+    _pending = NULL;
+    _pending_capacity = 0;
+}
+
+void QueueDeletion(struct Deletion deletion, uint64_t timeline_value){
+    // Destroying later than asked is always safe and keeps the queue ordered
+    if(_pending_count > 0 && timeline_value < _pending[_pending_head + _pending_count - 1].timeline_value){
+        timeline_value = _pending[_pending_head + _pending_count - 1].timeline_value;
+    }
+
+    // Compact before growing, collected entries leave a gap at the front
+    if(_pending_head + _pending_count == _pending_capacity){
+        if(_pending_head > 0){
+            memmove(_pending, _pending + _pending_head, sizeof(struct PendingDeletion) * _pending_count);
+            _pending_head = 0;
+        } else {
+            _pending_capacity = _pending_capacity > 0 ? _pending_capacity * 2 : 64;
+            _pending = realloc(_pending, sizeof(struct PendingDeletion) * _pending_capacity);
+            if(_pending == NULL){
+                fprintf(stderr, "ERROR: failed to grow the deletion queue\n");
+                exit(EXIT_FAILURE);
+            }
+        }
+    }
+
+    struct PendingDeletion* pending = &_pending[_pending_head + _pending_count];
+    pending->deletion = deletion;
+    pending->timeline_value = timeline_value;
+    _pending_count += 1;
+}
+
+void CollectDeletions(){
+    while(_pending_count > 0){
+        struct PendingDeletion* pending = &_pending[_pending_head];
+        if(!IsQueueTimelineComplete(_device, _timeline, pending->timeline_value)){
+            break;
+        }
+        _Destroy(&pending->deletion);
+        _pending_head += 1;
+        _pending_count -= 1;
+    }
+    if(_pending_count == 0){
+        _pending_head = 0;
+    }
+}
+
+uint32_t GetPendingDeletionCount(){
+    return _pending_count;
+}
+
+void _Destroy(struct Deletion* deletion){
+    switch(deletion->type){
+        case DELETION_FRAMEBUFFER:
+            vkDestroyFramebuffer(_device, deletion->handle.framebuffer, GetHostAllocator());
+            break;
+        case DELETION_IMAGE_VIEW:
+            vkDestroyImageView(_device, deletion->handle.image_view, GetHostAllocator());
+            break;
+        case DELETION_SWAP_CHAIN:
+            vkDestroySwapchainKHR(_device, deletion->handle.swap_chain, GetHostAllocator());
+            break;
+        case DELETION_PIPELINE:
+            vkDestroyPipeline(_device, deletion->handle.pipeline, GetHostAllocator());
+            break;
+        case DELETION_SHADER_MODULE:
+            vkDestroyShaderModule(_device, deletion->handle.shader_module, GetHostAllocator());
+            break;
+        case DELETION_PIPELINE_LAYOUT:
+            vkDestroyPipelineLayout(_device, deletion->handle.pipeline_layout, GetHostAllocator());
+            break;
+        case DELETION_RENDER_PASS:
+            vkDestroyRenderPass(_device, deletion->handle.render_pass, GetHostAllocator());
+            break;
+        case DELETION_BUFFER:
+            vkDestroyBuffer(_device, deletion->handle.buffer, GetHostAllocator());
+            break;
+        case DELETION_MEMORY:
+            // Also unmaps it
+            vkFreeMemory(_device, deletion->handle.memory, GetHostAllocator());
+            break;
+        case DELETION_DESCRIPTOR_POOL:
+            vkDestroyDescriptorPool(_device, deletion->handle.descriptor_pool, GetHostAllocator());
+            break;
+        case DELETION_QUERY_POOL:
+            vkDestroyQueryPool(_device, deletion->handle.query_pool, GetHostAllocator());
+            break;
+        case DELETION_COMMAND_BUFFER:
+            vkFreeCommandBuffers(_device, deletion->command_pool, 1, &deletion->handle.command_buffer);
+            break;
+        case DELETION_ALLOCATION:
+            GpuFree(&deletion->handle.allocation);
+            break;
+    }
+}
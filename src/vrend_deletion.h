@@ -0,0 +1,62 @@
+#ifndef _VREND_DELETION_H_
+#define _VREND_DELETION_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <vulkan/vulkan.h>
+
+#include "vrend_timeline.h"
+#include "vrend_memory.h"
+
+enum DeletionType {
+    DELETION_FRAMEBUFFER,
+    DELETION_IMAGE_VIEW,
+    DELETION_SWAP_CHAIN,
+    DELETION_PIPELINE,
+    DELETION_SHADER_MODULE,
+    DELETION_PIPELINE_LAYOUT,
+    DELETION_RENDER_PASS,
+    DELETION_BUFFER,
+    DELETION_MEMORY,
+    DELETION_DESCRIPTOR_POOL,
+    DELETION_QUERY_POOL,
+    DELETION_COMMAND_BUFFER,
+    DELETION_ALLOCATION
+};
+
+struct Deletion {
+    enum DeletionType                       type;
+    VkCommandPool                           command_pool;           // Only for DELETION_COMMAND_BUFFER
+    union {
+        VkFramebuffer                       framebuffer;
+        VkImageView                         image_view;
+        VkSwapchainKHR                      swap_chain;
+        VkPipeline                          pipeline;
+        VkShaderModule                      shader_module;
+        VkPipelineLayout                    pipeline_layout;
+        VkRenderPass                        render_pass;
+        VkBuffer                            buffer;
+        VkDeviceMemory                      memory;
+        VkDescriptorPool                    descriptor_pool;
+        VkQueryPool                         query_pool;
+        VkCommandBuffer                     command_buffer;
+        struct GpuAllocation                allocation;
+    } handle;
+};
+
+// Objects are destroyed once the timeline reaches the value they were queued with
+void InitDeletionQueue(VkDevice device, struct QueueTimeline* timeline);
+
+// Waits for the last submission and destroys everything still queued
+void FreeDeletionQueue();
+
+// Use the last submitted value for objects the GPU may still use, or a later
+// one to cover future submissions. A value lower than one already queued is
+// raised to it so the queue stays ordered.
+void QueueDeletion(struct Deletion deletion, uint64_t timeline_value);
+
+// Destroys everything whose value has been reached, never waits
+void CollectDeletions();
+uint32_t GetPendingDeletionCount();
+
+#endif
@@ -0,0 +1,261 @@
+#include "vrend.h"
+#include "vrend_host_alloc.h"
+
+#define MIN_HOST_CLASS_SIZE ((size_t)1 << MIN_HOST_CLASS_SHIFT)
+#define HOST_LARGE_CLASS NUM_HOST_CLASSES
+
+// Space kept for the slab header in front of a large allocation
+#define HOST_HEADER_SIZE 64
+
+// Slabs and large allocations start on a HOST_SLAB_SIZE boundary with this
+// header, so any pointer handed out finds its header by masking
+struct HostSlab {
+    void*                                   raw;                    // From malloc, the slab is aligned up from it
+    uint32_t                                scope;
+    uint32_t                                size_class;             // HOST_LARGE_CLASS for a large allocation
+    size_t                                  size;                   // Usable bytes of a large allocation
+    struct HostSlab*                        next;                   // Slabs of the same scope
+};
+
+struct HostArena {
+    SDL_mutex*                              mutex;
+    void*                                   free_lists[NUM_HOST_CLASSES];
+    struct HostSlab*                        slabs;
+    struct HostScopeStats                   stats;
+};
+
+static VkBool32                         _initialized = VK_FALSE;
+static VkAllocationCallbacks            _callbacks = {0};
+static struct HostArena                 _arenas[NUM_HOST_SCOPES] = {0};
+
+void* VKAPI_PTR _Allocate(void* user_data, size_t size, size_t alignment, VkSystemAllocationScope scope);
+void* VKAPI_PTR _Reallocate(void* user_data, void* original, size_t size, size_t alignment, VkSystemAllocationScope scope);
+void VKAPI_PTR _Free(void* user_data, void* memory);
+void VKAPI_PTR _InternalAllocation(void* user_data, size_t size, VkInternalAllocationType type, VkSystemAllocationScope scope);
+void VKAPI_PTR _InternalFree(void* user_data, size_t size, VkInternalAllocationType type, VkSystemAllocationScope scope);
+struct HostSlab* _NewSlab(size_t size, uint32_t scope, uint32_t size_class);
+struct HostSlab* _GetSlab(void* memory);
+size_t _GetCapacity(struct HostSlab* slab);
+uint32_t _GetSizeClass(size_t size, size_t alignment);
+struct HostArena* _GetArena(VkSystemAllocationScope scope);
+
+void InitHostAllocator(){
+    for(uint32_t i = 0; i < NUM_HOST_SCOPES; i ++){
+        memset(&_arenas[i], 0, sizeof(struct HostArena));
+        _arenas[i].mutex = SDL_CreateMutex();
+    }
+
+    _callbacks.pUserData = NULL;
+    _callbacks.pfnAllocation = _Allocate;
+    _callbacks.pfnReallocation = _Reallocate;
+    _callbacks.pfnFree = _Free;
+    _callbacks.pfnInternalAllocation = _InternalAllocation;
+    _callbacks.pfnInternalFree = _InternalFree;
+    _initialized = VK_TRUE;
+}
+
+void FreeHostAllocator(){
+    if(!_initialized) return;
+
+    for(uint32_t i = 0; i < NUM_HOST_SCOPES; i ++){
+        struct HostArena* arena = &_arenas[i];
+        if(arena->stats.live_count > 0){
+            fprintf(stderr, "WARNING: %llu host allocations in %s were never freed\n",
+                (unsigned long long)arena->stats.live_count, STR_VK_SYSTEM_ALLOCATION_SCOPE(i)
+            );
+        }
+        struct HostSlab* slab = arena->slabs;
+        while(slab != NULL){
+            struct HostSlab* next = slab->next;
+            free(slab->raw);
+            slab = next;
+        }
+        SDL_DestroyMutex(arena->mutex);
+        memset(arena, 0, sizeof(struct HostArena));
+    }
+    _initialized = VK_FALSE;
+}
+
+const VkAllocationCallbacks* GetHostAllocator(){
+    return _initialized ? &_callbacks : NULL;
+}
+
+void GetHostScopeStats(VkSystemAllocationScope scope, struct HostScopeStats* stats){
+    struct HostArena* arena = _GetArena(scope);
+    SDL_LockMutex(arena->mutex);
+    *stats = arena->stats;
+    SDL_UnlockMutex(arena->mutex);
+}
+
+uint64_t GetHostAllocationCount(){
+    if(!_initialized) return 0;
+
+    uint64_t count = 0;
+    for(uint32_t i = 0; i < NUM_HOST_SCOPES; i ++){
+        SDL_LockMutex(_arenas[i].mutex);
+        count += _arenas[i].stats.allocations;
+        SDL_UnlockMutex(_arenas[i].mutex);
+    }
+    return count;
+}
+
+void* VKAPI_PTR _Allocate(void* user_data, size_t size, size_t alignment, VkSystemAllocationScope scope){
+    if(size == 0) return NULL;
+
+    // The header is found by masking, which an alignment this large would break
+    if(alignment >= HOST_SLAB_SIZE){
+        fprintf(stderr, "ERROR: host allocation alignment %zu is not supported\n", alignment);
+        exit(EXIT_FAILURE);
+    }
+
+    struct HostArena* arena = _GetArena(scope);
+    uint32_t scope_index = (uint32_t)(arena - _arenas);
+    uint32_t size_class = _GetSizeClass(size, alignment);
+    void* memory = NULL;
+    size_t capacity = 0;
+
+    SDL_LockMutex(arena->mutex);
+    if(size_class == HOST_LARGE_CLASS){
+        size_t offset = alignment > HOST_HEADER_SIZE ? alignment : HOST_HEADER_SIZE;
+        struct HostSlab* slab = _NewSlab(offset + size, scope_index, HOST_LARGE_CLASS);
+        if(slab != NULL){
+            slab->size = size;
+            memory = (uint8_t*)slab + offset;
+            capacity = size;
+            arena->stats.large += 1;
+        }
+    } else {
+        size_t block_size = MIN_HOST_CLASS_SIZE << size_class;
+        if(arena->free_lists[size_class] == NULL){
+
+            // Blocks start past the header at a multiple of their size, so they are aligned to it
+            struct HostSlab* slab = _NewSlab(HOST_SLAB_SIZE, scope_index, size_class);
+            if(slab != NULL){
+                slab->next = arena->slabs;
+                arena->slabs = slab;
+                arena->stats.slab_bytes += HOST_SLAB_SIZE;
+                size_t first = (sizeof(struct HostSlab) + block_size - 1) / block_size * block_size;
+                for(size_t offset = HOST_SLAB_SIZE - block_size; offset >= first; offset -= block_size){
+                    void* block = (uint8_t*)slab + offset;
+                    *(void**)block = arena->free_lists[size_class];
+                    arena->free_lists[size_class] = block;
+                    if(offset == first) break;
+                }
+            }
+        }
+        memory = arena->free_lists[size_class];
+        if(memory != NULL){
+            arena->free_lists[size_class] = *(void**)memory;
+            capacity = block_size;
+        }
+    }
+
+    if(memory != NULL){
+        arena->stats.allocations += 1;
+        arena->stats.live_count += 1;
+        arena->stats.live_bytes += capacity;
+        if(arena->stats.live_bytes > arena->stats.peak_bytes){
+            arena->stats.peak_bytes = arena->stats.live_bytes;
+        }
+    }
+    SDL_UnlockMutex(arena->mutex);
+    return memory;
+}
+
+void* VKAPI_PTR _Reallocate(void* user_data, void* original, size_t size, size_t alignment, VkSystemAllocationScope scope){
+    if(original == NULL){
+        return _Allocate(user_data, size, alignment, scope);
+    }
+    if(size == 0){
+        _Free(user_data, original);
+        return NULL;
+    }
+
+    struct HostArena* arena = _GetArena(scope);
+    SDL_LockMutex(arena->mutex);
+    arena->stats.reallocations += 1;
+    SDL_UnlockMutex(arena->mutex);
+
+    // Shrinking, or growing within the size class, keeps the block
+    size_t capacity = _GetCapacity(_GetSlab(original));
+    if(size <= capacity && ((uintptr_t)original & (alignment - 1)) == 0){
+        return original;
+    }
+
+    void* memory = _Allocate(user_data, size, alignment, scope);
+    if(memory == NULL) return NULL;
+    memcpy(memory, original, capacity < size ? capacity : size);
+    _Free(user_data, original);
+    return memory;
+}
+
+void VKAPI_PTR _Free(void* user_data, void* memory){
+    if(memory == NULL) return;
+
+    struct HostSlab* slab = _GetSlab(memory);
+    struct HostArena* arena = &_arenas[slab->scope];
+    size_t capacity = _GetCapacity(slab);
+
+    SDL_LockMutex(arena->mutex);
+    arena->stats.frees += 1;
+    arena->stats.live_count -= 1;
+    arena->stats.live_bytes -= capacity;
+    if(slab->size_class == HOST_LARGE_CLASS){
+        free(slab->raw);
+    } else {
+        *(void**)memory = arena->free_lists[slab->size_class];
+        arena->free_lists[slab->size_class] = memory;
+    }
+    SDL_UnlockMutex(arena->mutex);
+}
+
+void VKAPI_PTR _InternalAllocation(void* user_data, size_t size, VkInternalAllocationType type, VkSystemAllocationScope scope){
+    struct HostArena* arena = _GetArena(scope);
+    SDL_LockMutex(arena->mutex);
+    arena->stats.internal_bytes += (int64_t)size;
+    SDL_UnlockMutex(arena->mutex);
+}
+
+void VKAPI_PTR _InternalFree(void* user_data, size_t size, VkInternalAllocationType type, VkSystemAllocationScope scope){
+    struct HostArena* arena = _GetArena(scope);
+    SDL_LockMutex(arena->mutex);
+    arena->stats.internal_bytes -= (int64_t)size;
+    SDL_UnlockMutex(arena->mutex);
+}
+
+// size counts from the start of the header. Called with the arena locked.
+struct HostSlab* _NewSlab(size_t size, uint32_t scope, uint32_t size_class){
+    void* raw = malloc(size + HOST_SLAB_SIZE);
+    if(raw == NULL) return NULL;
+
+    uintptr_t base = ((uintptr_t)raw + HOST_SLAB_SIZE - 1) & ~(uintptr_t)(HOST_SLAB_SIZE - 1);
+    struct HostSlab* slab = (struct HostSlab*)base;
+    slab->raw = raw;
+    slab->scope = scope;
+    slab->size_class = size_class;
+    slab->size = 0;
+    slab->next = NULL;
+    return slab;
+}
+
+struct HostSlab* _GetSlab(void* memory){
+    return (struct HostSlab*)((uintptr_t)memory & ~(uintptr_t)(HOST_SLAB_SIZE - 1));
+}
+
+size_t _GetCapacity(struct HostSlab* slab){
+    return slab->size_class == HOST_LARGE_CLASS ? slab->size : MIN_HOST_CLASS_SIZE << slab->size_class;
+}
+
+// Blocks are aligned to their size, so the class also has to cover the alignment
+uint32_t _GetSizeClass(size_t size, size_t alignment){
+    size_t needed = size > alignment ? size : alignment;
+    for(uint32_t size_class = 0; size_class < NUM_HOST_CLASSES; size_class ++){
+        if((MIN_HOST_CLASS_SIZE << size_class) >= needed) return size_class;
+    }
+    return HOST_LARGE_CLASS;
+}
+
+struct HostArena* _GetArena(VkSystemAllocationScope scope){
+    uint32_t index = (uint32_t)scope < NUM_HOST_SCOPES ? (uint32_t)scope : VK_SYSTEM_ALLOCATION_SCOPE_OBJECT;
+    return &_arenas[index];
+}
@@ -0,0 +1,47 @@
+#ifndef _VREND_HOST_ALLOC_H_
+#define _VREND_HOST_ALLOC_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <SDL2/SDL.h>
+#include <vulkan/vulkan.h>
+
+// Requests up to 4 KiB are rounded to a power of two size class and carved
+// out of 64 KiB slabs. Each allocation scope has its own slabs, so command
+// scope churn never fragments long lived object and device memory. Larger
+// requests get their own allocation.
+#define HOST_SLAB_SIZE (64 * 1024)
+#define MIN_HOST_CLASS_SHIFT 4                                      // 16 bytes
+#define NUM_HOST_CLASSES 9
+#define NUM_HOST_SCOPES (VK_SYSTEM_ALLOCATION_SCOPE_INSTANCE + 1)
+
+struct HostScopeStats {
+    uint64_t                                allocations;            // Including reallocations that moved
+    uint64_t                                reallocations;
+    uint64_t                                frees;
+    uint64_t                                large;                  // Too big for a size class
+    uint64_t                                live_count;
+    uint64_t                                live_bytes;             // Rounded up to the size class
+    uint64_t                                peak_bytes;
+    uint64_t                                slab_bytes;             // Reserved for the scope's size classes
+    int64_t                                 internal_bytes;         // Reported by the driver's internal notifications
+};
+
+// Must be called before the instance is created. Until then
+// GetHostAllocator returns NULL and Vulkan uses its own allocator.
+void InitHostAllocator();
+
+// Called after the instance is destroyed. Frees every slab and warns about
+// allocations still live.
+void FreeHostAllocator();
+
+// Passed to every create and destroy pair, the callbacks are thread safe
+const VkAllocationCallbacks* GetHostAllocator();
+
+void GetHostScopeStats(VkSystemAllocationScope scope, struct HostScopeStats* stats);
+
+// Allocations across every scope so far, for per frame churn
+uint64_t GetHostAllocationCount();
+
+#endif
@@ -0,0 +1,229 @@
+#include "vrend_jobs.h"
+
+struct Job {
+    JobFunction                             function;
+    void*                                   data;
+    struct JobCounter*                      counter;
+};
+
+static uint32_t                         _num_workers = 0;
+static SDL_Thread*                      _workers[MAX_JOB_WORKERS] = {0};
+static uint32_t                         _worker_indices[MAX_JOB_WORKERS] = {0};
+static SDL_mutex*                       _mutex = NULL;
+static SDL_cond*                        _work_cond = NULL;          // Signaled when a job is queued
+static SDL_cond*                        _done_cond = NULL;          // Signaled when a counter reaches zero
+static struct Job                       _queue[JOB_QUEUE_SIZE] = {0};
+static uint32_t                         _queue_head = 0;
+static uint32_t                         _queue_count = 0;
+static struct Job                       _background[JOB_QUEUE_SIZE] = {0};  // Only taken when _queue is empty
+static uint32_t                         _background_head = 0;
+static uint32_t                         _background_count = 0;
+static uint32_t                         _background_running = 0;
+static SDL_threadID                     _callers[MAX_JOB_CALLERS] = {0};    // Owner of slot _num_workers + i
+static uint32_t                         _num_callers = 0;
+static VkBool32                         _quit = VK_FALSE;
+
+int _JobWorker(void* data);
+void _RunJob(struct Job* job, uint32_t worker_index);
+VkBool32 _CanStartBackgroundJob();
+uint32_t _GetCallerIndex();
+
+void InitJobPool(uint32_t num_workers){
+    if(num_workers == 0){
+        int num_cpus = SDL_GetCPUCount();
+        num_workers = num_cpus > 1 ? num_cpus - 1 : 1;
+    }
+    if(num_workers > MAX_JOB_WORKERS) num_workers = MAX_JOB_WORKERS;
+
+    _mutex = SDL_CreateMutex();
+    _work_cond = SDL_CreateCond();
+    _done_cond = SDL_CreateCond();
+    if(_mutex == NULL || _work_cond == NULL || _done_cond == NULL){
+        fprintf(stderr, "SDL2 ERROR: failed to create job pool sync objects: %s\n", SDL_GetError());
+        exit(EXIT_FAILURE);
+    }
+
+    _quit = VK_FALSE;
+    _queue_head = _queue_count = 0;
+    _background_head = _background_count = _background_running = 0;
+    _num_callers = 0;
+    _num_workers = num_workers;
+    for(uint32_t i = 0; i < _num_workers; i ++){
+        _worker_indices[i] = i;
+        _workers[i] = SDL_CreateThread(_JobWorker, "vrend_job", &_worker_indices[i]);
+        if(_workers[i] == NULL){
+            fprintf(stderr, "SDL2 ERROR: failed to create job worker: %s\n", SDL_GetError());
+            exit(EXIT_FAILURE);
+        }
+    }
+}
+
+void FreeJobPool(){
+    SDL_LockMutex(_mutex);
+    _quit = VK_TRUE;
+    SDL_CondBroadcast(_work_cond);
+    SDL_UnlockMutex(_mutex);
+
+    for(uint32_t i = 0; i < _num_workers; i ++){
+        SDL_WaitThread(_workers[i], NULL);
+        _workers[i] = NULL;
+    }
+    _num_workers = 0;
+
+    SDL_DestroyCond(_done_cond);
+    SDL_DestroyCond(_work_cond);
+    SDL_DestroyMutex(_mutex);
+}
+
+uint32_t GetJobWorkerCount(){
+    return _num_workers;
+}
+
+uint32_t GetJobSlotCount(){
+    return _num_workers + MAX_JOB_CALLERS;
+}
+
+uint32_t GetJobCallerIndex(){
+    SDL_LockMutex(_mutex);
+    uint32_t index = _GetCallerIndex();
+    SDL_UnlockMutex(_mutex);
+    return index;
+}
+
+void SubmitJob(JobFunction function, void* data, struct JobCounter* counter){
+    struct Job job = { function, data, counter };
+    if(counter != NULL){
+        SDL_AtomicAdd(&counter->pending, 1);
+    }
+
+    SDL_LockMutex(_mutex);
+    if(_queue_count == JOB_QUEUE_SIZE || _num_workers == 0){
+        uint32_t caller_index = _GetCallerIndex();
+        SDL_UnlockMutex(_mutex);
+        _RunJob(&job, caller_index);
+        return;
+    }
+    _queue[(_queue_head + _queue_count) % JOB_QUEUE_SIZE] = job;
+    _queue_count += 1;
+    SDL_CondSignal(_work_cond);
+    SDL_UnlockMutex(_mutex);
+}
+
+void SubmitBackgroundJob(JobFunction function, void* data, struct JobCounter* counter){
+    struct Job job = { function, data, counter };
+    if(counter != NULL){
+        SDL_AtomicAdd(&counter->pending, 1);
+    }
+
+    SDL_LockMutex(_mutex);
+    if(_background_count == JOB_QUEUE_SIZE || _num_workers == 0){
+        uint32_t caller_index = _GetCallerIndex();
+        SDL_UnlockMutex(_mutex);
+        _RunJob(&job, caller_index);
+        return;
+    }
+    _background[(_background_head + _background_count) % JOB_QUEUE_SIZE] = job;
+    _background_count += 1;
+    SDL_CondSignal(_work_cond);
+    SDL_UnlockMutex(_mutex);
+}
+
+void WaitJobCounter(struct JobCounter* counter){
+    if(SDL_AtomicGet(&counter->pending) == 0){
+        return;
+    }
+    SDL_LockMutex(_mutex);
+    uint32_t caller_index = _GetCallerIndex();
+    while(SDL_AtomicGet(&counter->pending) > 0){
+
+        // Queued jobs are run here instead of waiting for a worker to get to them
+        if(_queue_count > 0){
+            struct Job job = _queue[_queue_head];
+            _queue_head = (_queue_head + 1) % JOB_QUEUE_SIZE;
+            _queue_count -= 1;
+            SDL_UnlockMutex(_mutex);
+            _RunJob(&job, caller_index);
+            SDL_LockMutex(_mutex);
+            continue;
+        }
+        SDL_CondWait(_done_cond, _mutex);
+    }
+    SDL_UnlockMutex(_mutex);
+}
+
+VkBool32 IsJobCounterDone(struct JobCounter* counter){
+    return SDL_AtomicGet(&counter->pending) == 0;
+}
+
+int _JobWorker(void* data){
+    uint32_t worker_index = *(uint32_t*)data;
+
+    SDL_LockMutex(_mutex);
+    while(VK_TRUE){
+        while(_queue_count == 0 && !_CanStartBackgroundJob() && !_quit){
+            SDL_CondWait(_work_cond, _mutex);
+        }
+
+        // Background jobs left at quit still run so their counters finish
+        struct Job job = {0};
+        VkBool32 background = VK_FALSE;
+        if(_queue_count > 0){
+            job = _queue[_queue_head];
+            _queue_head = (_queue_head + 1) % JOB_QUEUE_SIZE;
+            _queue_count -= 1;
+        } else if(_background_count > 0 && (_quit || _CanStartBackgroundJob())){
+            job = _background[_background_head];
+            _background_head = (_background_head + 1) % JOB_QUEUE_SIZE;
+            _background_count -= 1;
+            _background_running += 1;
+            background = VK_TRUE;
+        } else {
+            break;
+        }
+
+        SDL_UnlockMutex(_mutex);
+        _RunJob(&job, worker_index);
+        SDL_LockMutex(_mutex);
+
+        // Another worker may have been held back by the limit
+        if(background){
+            _background_running -= 1;
+            SDL_CondSignal(_work_cond);
+        }
+    }
+    SDL_UnlockMutex(_mutex);
+
+    return 0;
+}
+
+// One worker is always left for SubmitJob work, unless there is only one
+VkBool32 _CanStartBackgroundJob(){
+    uint32_t limit = _num_workers > 1 ? _num_workers - 1 : 1;
+    return _background_count > 0 && _background_running < limit;
+}
+
+// Called with _mutex held
+uint32_t _GetCallerIndex(){
+    SDL_threadID thread_id = SDL_ThreadID();
+    for(uint32_t i = 0; i < _num_callers; i ++){
+        if(_callers[i] == thread_id) return _num_workers + i;
+    }
+    if(_num_callers == MAX_JOB_CALLERS){
+        fprintf(stderr, "ERROR: more than %u threads outside the job pool run jobs, raise MAX_JOB_CALLERS\n", MAX_JOB_CALLERS);
+        exit(EXIT_FAILURE);
+    }
+    _callers[_num_callers] = thread_id;
+    _num_callers += 1;
+    return _num_workers + _num_callers - 1;
+}
+
+void _RunJob(struct Job* job, uint32_t worker_index){
+    job->function(job->data, worker_index);
+
+    // Broadcast under the lock so a waiter cannot miss the last decrement
+    if(job->counter != NULL && SDL_AtomicAdd(&job->counter->pending, -1) == 1){
+        SDL_LockMutex(_mutex);
+        SDL_CondBroadcast(_done_cond);
+        SDL_UnlockMutex(_mutex);
+    }
+}
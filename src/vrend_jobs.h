@@ -0,0 +1,49 @@
+#ifndef _VREND_JOBS_H_
+#define _VREND_JOBS_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <SDL2/SDL.h>
+#include <vulkan/vulkan.h>
+
+#define MAX_JOB_WORKERS 16
+#define JOB_QUEUE_SIZE 1024
+
+// Threads outside the pool that run jobs themselves, such as the main and
+// the render thread
+#define MAX_JOB_CALLERS 2
+
+// worker_index is in [0, GetJobWorkerCount()) for pool threads. Work run by
+// another thread, inline or while it waits, uses that thread's
+// GetJobCallerIndex(), so per worker resources need GetJobSlotCount() slots.
+typedef void (*JobFunction)(void* data, uint32_t worker_index);
+
+// Counts jobs that have not finished yet, must be zeroed before first use
+struct JobCounter {
+    SDL_atomic_t                            pending;
+};
+
+// 0 picks one worker per CPU core minus one
+void InitJobPool(uint32_t num_workers);
+void FreeJobPool();
+uint32_t GetJobWorkerCount();
+uint32_t GetJobSlotCount();
+
+// Slot of the calling thread, which must not be a pool thread. Each thread
+// gets its own the first time, from GetJobWorkerCount() on.
+uint32_t GetJobCallerIndex();
+
+// Runs the job inline when the queue is full
+void SubmitJob(JobFunction function, void* data, struct JobCounter* counter);
+
+// For long running work such as pipeline compiles. Only started when no
+// SubmitJob work is queued, and never on every worker at once, so per frame
+// jobs do not wait behind it.
+void SubmitBackgroundJob(JobFunction function, void* data, struct JobCounter* counter);
+
+// Runs queued SubmitJob work on the calling thread while waiting, as worker
+// GetJobCallerIndex()
+void WaitJobCounter(struct JobCounter* counter);
+VkBool32 IsJobCounterDone(struct JobCounter* counter);
+
+#endif
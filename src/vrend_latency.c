@@ -0,0 +1,56 @@
+#include "vrend_latency.h"
+
+static SDL_mutex*                       _mutex = NULL;
+static struct LatencyStats              _stats = {0};
+
+void InitLatencyTracker(){
+    _mutex = SDL_CreateMutex();
+    if(_mutex == NULL){
+        fprintf(stderr, "SDL2 ERROR: failed to create latency tracker mutex: %s\n", SDL_GetError());
+        exit(EXIT_FAILURE);
+    }
+    ResetLatencyStats();
+}
+
+void FreeLatencyTracker(){
+    SDL_DestroyMutex(_mutex);
+    _mutex = NULL;
+}
+
+void RecordInputToPresent(Uint64 input_time, Uint64 present_time){
+    if(present_time < input_time) return;
+    double latency_ms = (double)(present_time - input_time) / SDL_GetPerformanceFrequency() * 1000;
+
+    SDL_LockMutex(_mutex);
+    _stats.num_samples += 1;
+    _stats.mean_ms += (latency_ms - _stats.mean_ms) / _stats.num_samples;
+    if(_stats.num_samples == 1 || latency_ms < _stats.min_ms) _stats.min_ms = latency_ms;
+    if(latency_ms > _stats.max_ms) _stats.max_ms = latency_ms;
+    _stats.last_ms = latency_ms;
+    SDL_UnlockMutex(_mutex);
+}
+
+void GetLatencyStats(struct LatencyStats* stats){
+    SDL_LockMutex(_mutex);
+    *stats = _stats;
+    SDL_UnlockMutex(_mutex);
+}
+
+void ResetLatencyStats(){
+    SDL_LockMutex(_mutex);
+    _stats = (struct LatencyStats){0};
+    SDL_UnlockMutex(_mutex);
+}
+
+void PrintLatencyStats(const char* label){
+    struct LatencyStats stats = {0};
+    GetLatencyStats(&stats);
+    printf("INPUT TO PRESENT LATENCY (%s)\n{\n", label);
+    printf("\tSamples: %llu\n", (unsigned long long)stats.num_samples);
+    if(stats.num_samples > 0){
+        printf("\tMean: %.3f ms\n", stats.mean_ms);
+        printf("\tMin: %.3f ms\n", stats.min_ms);
+        printf("\tMax: %.3f ms\n", stats.max_ms);
+    }
+    printf("}\n\n");
+}
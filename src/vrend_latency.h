@@ -0,0 +1,26 @@
+#ifndef _VREND_LATENCY_H_
+#define _VREND_LATENCY_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <SDL2/SDL.h>
+#include <vulkan/vulkan.h>
+
+struct LatencyStats {
+    uint64_t                                num_samples;
+    double                                  mean_ms;                // Input timestamp to present call
+    double                                  min_ms;
+    double                                  max_ms;
+    double                                  last_ms;
+};
+
+void InitLatencyTracker();
+void FreeLatencyTracker();
+
+// Thread safe, both times come from SDL_GetPerformanceCounter
+void RecordInputToPresent(Uint64 input_time, Uint64 present_time);
+void GetLatencyStats(struct LatencyStats* stats);
+void ResetLatencyStats();
+void PrintLatencyStats(const char* label);
+
+#endif
@@ -0,0 +1,377 @@
+#include "vrend.h"
+#include "vrend_memory.h"
+#include "vrend_host_alloc.h"
+
+#define MIN_ALLOCATION_SIZE ((VkDeviceSize)1 << MIN_ALLOCATION_SHIFT)
+
+struct MemoryBlock {
+    VkDeviceMemory                          memory;                 // NULL for an unused slot
+    uint32_t                                memory_type;
+    VkBool32                                linear;
+    VkBool32                                dedicated;
+    VkDeviceSize                            size;
+    uint32_t                                max_order;              // size is MIN_ALLOCATION_SIZE << max_order
+    uint8_t*                                tree;                   // Largest free order + 1 under each node, 0 when none
+    uint8_t*                                mapped;
+    VkDeviceSize                            live_bytes;
+    VkDeviceSize                            used_bytes;
+    uint32_t                                num_allocations;
+};
+
+static VkDevice                         _device = NULL;
+static VkPhysicalDeviceMemoryProperties _properties = {0};
+static VkDeviceSize                     _granularity = 1;
+static struct MemoryBlock               _blocks[MAX_MEMORY_BLOCKS] = {0};
+static uint64_t                         _device_allocations = 0;
+static VkDeviceSize                     _heap_bytes[VK_MAX_MEMORY_HEAPS] = {0};    // Block bytes per heap
+
+// Driver numbers as of the last UpdateGpuMemoryBudget
+static VkPhysicalDevice                 _budget_device = NULL;      // NULL without VK_EXT_memory_budget
+static VkDeviceSize                     _heap_budgets[VK_MAX_MEMORY_HEAPS] = {0};
+static VkDeviceSize                     _heap_usage[VK_MAX_MEMORY_HEAPS] = {0};
+static VkDeviceSize                     _heap_bytes_at_update[VK_MAX_MEMORY_HEAPS] = {0};
+
+VkResult _AllocateFromType(uint32_t memory_type, VkDeviceSize size, uint32_t order, VkBool32 linear, struct GpuAllocation* allocation);
+VkResult _CreateBlock(uint32_t memory_type, VkDeviceSize size, VkBool32 linear, VkBool32 dedicated, uint32_t* block_index);
+VkBool32 _AllocateFromBlock(uint32_t block_index, uint32_t order, VkDeviceSize* offset);
+void _UpdateParents(struct MemoryBlock* block, uint32_t index, uint32_t order);
+VkDeviceSize _GetBlockSize(uint32_t memory_type);
+void _FreeBlock(struct MemoryBlock* block);
+VkBool32 _HasOtherEmptyBlock(struct MemoryBlock* block);
+
+void InitGpuAllocator(VkDevice device, VkPhysicalDeviceMemoryProperties* properties, VkDeviceSize granularity){
+    _device = device;
+    _properties = *properties;
+    _granularity = granularity > 0 ? granularity : 1;
+    memset(_blocks, 0, sizeof(_blocks));
+    memset(_heap_bytes, 0, sizeof(_heap_bytes));
+    _device_allocations = 0;
+    _budget_device = NULL;
+}
+
+void FreeGpuAllocator(){
+    for(uint32_t i = 0; i < MAX_MEMORY_BLOCKS; i ++){
+        struct MemoryBlock* block = &_blocks[i];
+        if(block->memory == NULL) continue;
+        if(block->num_allocations > 0){
+            fprintf(stderr, "WARNING: %u GPU allocations in memory block %u were never freed\n", block->num_allocations, i);
+        }
+        _FreeBlock(block);
+    }
+}
+
+uint32_t FindGpuMemoryType(uint32_t type_bits, VkMemoryPropertyFlags required, VkMemoryPropertyFlags preferred){
+    VkMemoryPropertyFlags wanted[2] = { required | preferred, required };
+    for(uint32_t pass = 0; pass < 2; pass ++){
+        for(uint32_t i = 0; i < _properties.memoryTypeCount; i ++){
+            VkMemoryPropertyFlags type_flags = _properties.memoryTypes[i].propertyFlags;
+            if((type_bits & (1u << i)) && (type_flags & wanted[pass]) == wanted[pass]){
+                return i;
+            }
+        }
+    }
+    return UINT32_MAX;
+}
+
+VkResult GpuAllocate(
+            const VkMemoryRequirements* requirements,
+            VkMemoryPropertyFlags required,
+            VkMemoryPropertyFlags preferred,
+            VkBool32 linear,
+            struct GpuAllocation* allocation
+){
+    if(_granularity <= 1) linear = VK_TRUE;
+
+    // Buddy ranges are aligned to their own size, so a large enough range is always aligned
+    VkDeviceSize size = requirements->size > requirements->alignment ? requirements->size : requirements->alignment;
+    uint32_t order = 0;
+    while((MIN_ALLOCATION_SIZE << order) < size) order ++;
+
+    uint32_t preferred_type = FindGpuMemoryType(requirements->memoryTypeBits, required, preferred);
+    if(preferred_type == UINT32_MAX){
+        return VK_ERROR_FEATURE_NOT_PRESENT;
+    }
+    VkResult result = _AllocateFromType(preferred_type, requirements->size, order, linear, allocation);
+
+    // The preferred heap may be full while another type still fits
+    uint32_t required_type = FindGpuMemoryType(requirements->memoryTypeBits, required, 0);
+    if(result != VK_SUCCESS && required_type != preferred_type){
+        result = _AllocateFromType(required_type, requirements->size, order, linear, allocation);
+    }
+    return result;
+}
+
+void GpuFree(struct GpuAllocation* allocation){
+    if(allocation->memory == NULL) return;
+
+    struct MemoryBlock* block = &_blocks[allocation->block];
+    block->live_bytes -= allocation->size;
+    block->used_bytes -= MIN_ALLOCATION_SIZE << allocation->order;
+    block->num_allocations -= 1;
+
+    if(!block->dedicated){
+        uint32_t depth = block->max_order - allocation->order;
+        uint32_t index = (1u << depth) - 1 + (uint32_t)(allocation->offset >> (allocation->order + MIN_ALLOCATION_SHIFT));
+        block->tree[index] = allocation->order + 1;
+        _UpdateParents(block, index, allocation->order);
+    }
+
+    // Dedicated blocks are never reused, shared ones only go back to the
+    // driver once another empty block can take their place
+    if(block->num_allocations == 0 && (block->dedicated || _HasOtherEmptyBlock(block))){
+        _FreeBlock(block);
+    }
+    memset(allocation, 0, sizeof(struct GpuAllocation));
+}
+
+VkDeviceSize TrimGpuMemory(){
+    VkDeviceSize released = 0;
+    for(uint32_t i = 0; i < MAX_MEMORY_BLOCKS; i ++){
+        struct MemoryBlock* block = &_blocks[i];
+        if(block->memory == NULL || block->num_allocations > 0) continue;
+        released += block->size;
+        _FreeBlock(block);
+    }
+    return released;
+}
+
+VkResult CreateGpuBuffer(
+            const VkBufferCreateInfo* buffer_ci,
+            VkMemoryPropertyFlags required,
+            VkMemoryPropertyFlags preferred,
+            VkBuffer* buffer,
+            struct GpuAllocation* allocation
+){
+    VkResult result = vkCreateBuffer(_device, buffer_ci, GetHostAllocator(), buffer);
+    if(result != VK_SUCCESS) return result;
+
+    VkMemoryRequirements requirements = {0};
+    vkGetBufferMemoryRequirements(_device, *buffer, &requirements);
+    result = GpuAllocate(&requirements, required, preferred, VK_TRUE, allocation);
+    if(result != VK_SUCCESS){
+        vkDestroyBuffer(_device, *buffer, GetHostAllocator());
+        *buffer = NULL;
+        return result;
+    }
+    return vkBindBufferMemory(_device, *buffer, allocation->memory, allocation->offset);
+}
+
+VkMemoryPropertyFlags GetGpuAllocationFlags(const struct GpuAllocation* allocation){
+    if(allocation->memory == NULL) return 0;
+    return _properties.memoryTypes[_blocks[allocation->block].memory_type].propertyFlags;
+}
+
+void GetGpuAllocatorStats(struct GpuAllocatorStats* stats){
+    memset(stats, 0, sizeof(struct GpuAllocatorStats));
+    VkDeviceSize free_bytes = 0;
+    for(uint32_t i = 0; i < MAX_MEMORY_BLOCKS; i ++){
+        struct MemoryBlock* block = &_blocks[i];
+        if(block->memory == NULL) continue;
+
+        stats->num_blocks += 1;
+        stats->num_dedicated += block->dedicated ? 1 : 0;
+        stats->num_allocations += block->num_allocations;
+        stats->block_bytes += block->size;
+        stats->live_bytes += block->live_bytes;
+        stats->used_bytes += block->used_bytes;
+        if(!block->dedicated){
+            free_bytes += block->size - block->used_bytes;
+            VkDeviceSize largest = block->tree[0] > 0 ? MIN_ALLOCATION_SIZE << (block->tree[0] - 1) : 0;
+            if(largest > stats->largest_free) stats->largest_free = largest;
+        }
+    }
+    stats->fragmentation = free_bytes > 0 ? 1.0 - (double)stats->largest_free / free_bytes : 0.0;
+    stats->device_allocations = _device_allocations;
+}
+
+void EnableGpuMemoryBudget(VkPhysicalDevice physical_device){
+    _budget_device = physical_device;
+    UpdateGpuMemoryBudget();
+}
+
+VkBool32 IsGpuMemoryBudgetEnabled(){
+    return _budget_device != NULL;
+}
+
+void UpdateGpuMemoryBudget(){
+    if(_budget_device == NULL) return;
+
+    VkPhysicalDeviceMemoryBudgetPropertiesEXT budget_properties = {0};
+    budget_properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT;
+    budget_properties.pNext = NULL;
+    VkPhysicalDeviceMemoryProperties2 properties = {0};
+    properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2;
+    properties.pNext = &budget_properties;
+    vkGetPhysicalDeviceMemoryProperties2(_budget_device, &properties);
+
+    memcpy(_heap_budgets, budget_properties.heapBudget, sizeof(_heap_budgets));
+    memcpy(_heap_usage, budget_properties.heapUsage, sizeof(_heap_usage));
+    memcpy(_heap_bytes_at_update, _heap_bytes, sizeof(_heap_bytes));
+}
+
+uint32_t GetGpuHeapBudgets(struct GpuHeapBudget heaps[VK_MAX_MEMORY_HEAPS]){
+    for(uint32_t i = 0; i < _properties.memoryHeapCount; i ++){
+        struct GpuHeapBudget* heap = &heaps[i];
+        heap->flags = _properties.memoryHeaps[i].flags;
+        heap->size = _properties.memoryHeaps[i].size;
+        heap->block_bytes = _heap_bytes[i];
+        if(_budget_device != NULL){
+            VkDeviceSize usage = _heap_usage[i] + _heap_bytes[i];
+            heap->budget = _heap_budgets[i];
+            heap->usage = usage > _heap_bytes_at_update[i] ? usage - _heap_bytes_at_update[i] : 0;
+        } else {
+            heap->budget = heap->size / 100 * FALLBACK_BUDGET_PERCENT;
+            heap->usage = _heap_bytes[i];
+        }
+    }
+    return _properties.memoryHeapCount;
+}
+
+VkResult _AllocateFromType(uint32_t memory_type, VkDeviceSize size, uint32_t order, VkBool32 linear, struct GpuAllocation* allocation){
+    VkDeviceSize block_size = _GetBlockSize(memory_type);
+    uint32_t block_index = UINT32_MAX;
+    VkDeviceSize offset = 0;
+
+    if((MIN_ALLOCATION_SIZE << order) > block_size){
+        VkResult result = _CreateBlock(memory_type, size, linear, VK_TRUE, &block_index);
+        if(result != VK_SUCCESS) return result;
+    } else {
+        for(uint32_t i = 0; i < MAX_MEMORY_BLOCKS; i ++){
+            struct MemoryBlock* block = &_blocks[i];
+            if(block->memory == NULL || block->dedicated || block->memory_type != memory_type || block->linear != linear) continue;
+            if(_AllocateFromBlock(i, order, &offset)){
+                block_index = i;
+                break;
+            }
+        }
+        if(block_index == UINT32_MAX){
+            VkResult result = _CreateBlock(memory_type, block_size, linear, VK_FALSE, &block_index);
+            if(result != VK_SUCCESS) return result;
+            _AllocateFromBlock(block_index, order, &offset);
+        }
+    }
+
+    struct MemoryBlock* block = &_blocks[block_index];
+    block->live_bytes += size;
+    block->used_bytes += MIN_ALLOCATION_SIZE << order;
+    block->num_allocations += 1;
+
+    allocation->memory = block->memory;
+    allocation->offset = offset;
+    allocation->size = size;
+    allocation->mapped = block->mapped != NULL ? block->mapped + offset : NULL;
+    allocation->block = block_index;
+    allocation->order = order;
+    return VK_SUCCESS;
+}
+
+VkResult _CreateBlock(uint32_t memory_type, VkDeviceSize size, VkBool32 linear, VkBool32 dedicated, uint32_t* block_index){
+    uint32_t index = 0;
+    while(index < MAX_MEMORY_BLOCKS && _blocks[index].memory != NULL) index ++;
+    if(index == MAX_MEMORY_BLOCKS){
+        fprintf(stderr, "ERROR: out of GPU memory blocks, raise MAX_MEMORY_BLOCKS\n");
+        exit(EXIT_FAILURE);
+    }
+
+    struct MemoryBlock* block = &_blocks[index];
+
+    VkMemoryAllocateInfo memory_ai = {0};
+    memory_ai.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    memory_ai.pNext = NULL;
+    memory_ai.allocationSize = size;
+    memory_ai.memoryTypeIndex = memory_type;
+    VkResult result = vkAllocateMemory(_device, &memory_ai, GetHostAllocator(), &block->memory);
+    if(result != VK_SUCCESS){
+        block->memory = NULL;
+        return result;
+    }
+    _device_allocations += 1;
+    _heap_bytes[_properties.memoryTypes[memory_type].heapIndex] += size;
+
+    block->memory_type = memory_type;
+    block->linear = linear;
+    block->dedicated = dedicated;
+    block->size = size;
+    block->max_order = 0;
+    block->tree = NULL;
+    block->mapped = NULL;
+
+    if(_properties.memoryTypes[memory_type].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT){
+        VK_CHECK(vkMapMemory, _device, block->memory, 0, VK_WHOLE_SIZE, 0, (void**)&block->mapped);
+    }
+
+    // Every node starts out free, so its value is its own order + 1
+    if(!dedicated){
+        while((MIN_ALLOCATION_SIZE << block->max_order) < size) block->max_order ++;
+        uint32_t num_nodes = (2u << block->max_order) - 1;
+        block->tree = malloc(num_nodes);
+        for(uint32_t depth = 0; depth <= block->max_order; depth ++){
+            memset(block->tree + (1u << depth) - 1, block->max_order - depth + 1, 1u << depth);
+        }
+    }
+
+    *block_index = index;
+    return VK_SUCCESS;
+}
+
+// Descends towards the first free node of the wanted order
+VkBool32 _AllocateFromBlock(uint32_t block_index, uint32_t order, VkDeviceSize* offset){
+    struct MemoryBlock* block = &_blocks[block_index];
+    if(order > block->max_order || block->tree[0] < order + 1){
+        return VK_FALSE;
+    }
+
+    uint32_t index = 0;
+    for(uint32_t node_order = block->max_order; node_order > order; node_order --){
+        uint32_t left = index * 2 + 1;
+        index = block->tree[left] >= order + 1 ? left : left + 1;
+    }
+    block->tree[index] = 0;
+    _UpdateParents(block, index, order);
+
+    uint32_t depth = block->max_order - order;
+    *offset = (VkDeviceSize)(index - ((1u << depth) - 1)) << (order + MIN_ALLOCATION_SHIFT);
+    return VK_TRUE;
+}
+
+// Two free buddies merge into a free parent, otherwise the parent takes the larger child
+void _UpdateParents(struct MemoryBlock* block, uint32_t index, uint32_t order){
+    while(index > 0){
+        index = (index - 1) / 2;
+        order += 1;
+        uint8_t left = block->tree[index * 2 + 1];
+        uint8_t right = block->tree[index * 2 + 2];
+        if(left == order && right == order){
+            block->tree[index] = order + 1;
+        } else {
+            block->tree[index] = left > right ? left : right;
+        }
+    }
+}
+
+VkDeviceSize _GetBlockSize(uint32_t memory_type){
+    VkDeviceSize heap_size = _properties.memoryHeaps[_properties.memoryTypes[memory_type].heapIndex].size;
+    VkDeviceSize block_size = DEFAULT_MEMORY_BLOCK_SIZE;
+    while(block_size > MIN_MEMORY_BLOCK_SIZE && block_size > heap_size / 8){
+        block_size >>= 1;
+    }
+    return block_size;
+}
+
+void _FreeBlock(struct MemoryBlock* block){
+    _heap_bytes[_properties.memoryTypes[block->memory_type].heapIndex] -= block->size;
+    vkFreeMemory(_device, block->memory, GetHostAllocator());
+    free(block->tree);
+    memset(block, 0, sizeof(struct MemoryBlock));
+}
+
+VkBool32 _HasOtherEmptyBlock(struct MemoryBlock* block){
+    for(uint32_t i = 0; i < MAX_MEMORY_BLOCKS; i ++){
+        struct MemoryBlock* other = &_blocks[i];
+        if(other == block || other->memory == NULL || other->dedicated || other->num_allocations > 0) continue;
+        if(other->memory_type == block->memory_type && other->linear == block->linear){
+            return VK_TRUE;
+        }
+    }
+    return VK_FALSE;
+}
@@ -0,0 +1,104 @@
+#ifndef _VREND_MEMORY_H_
+#define _VREND_MEMORY_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vulkan/vulkan.h>
+
+// Blocks are carved into power of two sized ranges with a buddy allocator.
+// Blocks shrink on small heaps, down to MIN_MEMORY_BLOCK_SIZE.
+#define DEFAULT_MEMORY_BLOCK_SIZE (64 * 1024 * 1024)
+#define MIN_MEMORY_BLOCK_SIZE (1024 * 1024)
+#define MIN_ALLOCATION_SHIFT 8                                      // 256 bytes
+#define MAX_MEMORY_BLOCKS 1024
+
+// Share of a heap treated as its budget without VK_EXT_memory_budget. The
+// rest is left to other processes, the swap chain and driver internals.
+#define FALLBACK_BUDGET_PERCENT 80
+
+struct GpuAllocation {
+    VkDeviceMemory                          memory;
+    VkDeviceSize                            offset;
+    VkDeviceSize                            size;                   // As requested
+    uint8_t*                                mapped;                 // At offset, NULL unless host visible
+    uint32_t                                block;
+    uint32_t                                order;                  // Range is 1 << (order + MIN_ALLOCATION_SHIFT) bytes
+};
+
+struct GpuAllocatorStats {
+    uint32_t                                num_blocks;
+    uint32_t                                num_dedicated;          // Blocks holding one allocation too large to share
+    uint32_t                                num_allocations;
+    VkDeviceSize                            block_bytes;            // Allocated from the driver
+    VkDeviceSize                            live_bytes;             // Requested by live allocations
+    VkDeviceSize                            used_bytes;             // Live ranges including rounding
+    VkDeviceSize                            largest_free;
+    double                                  fragmentation;          // 1 - largest_free / free bytes
+    uint64_t                                device_allocations;     // vkAllocateMemory calls so far
+};
+
+struct GpuHeapBudget {
+    VkMemoryHeapFlags                       flags;
+    VkDeviceSize                            size;
+    VkDeviceSize                            budget;                 // Usable by this process before allocations may fail
+    VkDeviceSize                            usage;                  // By the whole process, or only this allocator without the extension
+    VkDeviceSize                            block_bytes;            // Allocated by this allocator
+};
+
+// Not thread safe, only used from the thread that draws. Linear and
+// optimal resources get separate blocks when granularity is above 1, so
+// bufferImageGranularity never has to be padded for.
+void InitGpuAllocator(VkDevice device, VkPhysicalDeviceMemoryProperties* properties, VkDeviceSize granularity);
+
+// Frees every block, warns about allocations that were never freed
+void FreeGpuAllocator();
+
+// Tries a type with required and preferred flags first, then one with only
+// the required flags. UINT32_MAX when no type fits.
+uint32_t FindGpuMemoryType(uint32_t type_bits, VkMemoryPropertyFlags required, VkMemoryPropertyFlags preferred);
+
+// linear is VK_TRUE for buffers and linear images. Host visible blocks stay
+// mapped, so mapped is valid for the whole life of the allocation.
+VkResult GpuAllocate(
+    const VkMemoryRequirements* requirements,
+    VkMemoryPropertyFlags required,
+    VkMemoryPropertyFlags preferred,
+    VkBool32 linear,
+    struct GpuAllocation* allocation
+);
+
+// An emptied block is kept while it is the only empty one of its memory
+// type, so freeing and allocating again never reaches the driver
+void GpuFree(struct GpuAllocation* allocation);
+
+// Frees every empty block. Returns the bytes released.
+VkDeviceSize TrimGpuMemory();
+
+// Creates the buffer, allocates for it and binds it
+VkResult CreateGpuBuffer(
+    const VkBufferCreateInfo* buffer_ci,
+    VkMemoryPropertyFlags required,
+    VkMemoryPropertyFlags preferred,
+    VkBuffer* buffer,
+    struct GpuAllocation* allocation
+);
+
+// Flags of the memory type the allocation was made from, which may lack preferred ones
+VkMemoryPropertyFlags GetGpuAllocationFlags(const struct GpuAllocation* allocation);
+
+void GetGpuAllocatorStats(struct GpuAllocatorStats* stats);
+
+// Takes budgets and usage from the driver from now on. VK_EXT_memory_budget
+// must be enabled on the device.
+void EnableGpuMemoryBudget(VkPhysicalDevice physical_device);
+VkBool32 IsGpuMemoryBudgetEnabled();
+
+// Queries the driver again. Its numbers are only refreshed here, blocks
+// allocated and freed since are added to the usage it reported.
+void UpdateGpuMemoryBudget();
+
+// Fills one entry per memory heap and returns how many
+uint32_t GetGpuHeapBudgets(struct GpuHeapBudget heaps[VK_MAX_MEMORY_HEAPS]);
+
+#endif
@@ -0,0 +1,169 @@
+#include "vrend_pacer.h"
+
+// Bounds for the adaptive sleep margin. The margin is the part of the frame
+// that is spun instead of slept, and tracks the worst observed oversleep.
+#define MIN_SLEEP_MARGIN_MS 0.25
+#define MAX_SLEEP_MARGIN_MS 2.0
+
+static double                           _ticks_per_ms = 0.0;
+static double                           _target_hz = FRAME_PACER_UNLIMITED;
+static Uint64                           _period_ticks = 0;
+static Uint64                           _next_deadline = 0;
+static Uint64                           _last_frame = 0;
+static double                           _sleep_margin_ms = MAX_SLEEP_MARGIN_MS;
+
+// Running statistics since the last reset
+static uint64_t                         _num_frames = 0;
+static double                           _mean_frame_ms = 0.0;
+static double                           _m2_frame_ms = 0.0;
+static double                           _max_frame_ms = 0.0;
+static double                           _total_ms = 0.0;
+static double                           _slept_ms = 0.0;
+static double                           _spun_ms = 0.0;
+
+void _SleepUntil(Uint64 deadline);
+void _RecordFrameTime(Uint64 now);
+
+void InitFramePacer(double target_hz){
+    _ticks_per_ms = (double)SDL_GetPerformanceFrequency() / 1000.0;
+    _last_frame = SDL_GetPerformanceCounter();
+    SetFramePacerTarget(target_hz);
+    ResetFramePacerStats();
+}
+
+void SetFramePacerTarget(double target_hz){
+    if(target_hz < 0.0) target_hz = FRAME_PACER_UNLIMITED;
+    _target_hz = target_hz;
+    _period_ticks = target_hz > 0.0 ? (Uint64)(_ticks_per_ms * 1000.0 / target_hz) : 0;
+
+    // Restart the deadline sequence from the next frame
+    _next_deadline = 0;
+}
+
+double GetFramePacerTarget(){
+    return _target_hz;
+}
+
+void PaceFrame(VkPresentModeKHR present_mode, int refresh_hz){
+
+    Uint64 now = SDL_GetPerformanceCounter();
+
+    // FIFO already blocks in present at the display rate, so sleeping on top
+    // of it for a target at or above that rate would only add latency
+    VkBool32 vsync_paced = VK_FALSE;
+    if(present_mode == VK_PRESENT_MODE_FIFO_KHR || present_mode == VK_PRESENT_MODE_FIFO_RELAXED_KHR){
+        if(refresh_hz > 0 && (_target_hz == FRAME_PACER_UNLIMITED || _target_hz >= refresh_hz - 0.5)){
+            vsync_paced = VK_TRUE;
+        }
+    }
+
+    if(_period_ticks == 0 || vsync_paced){
+        _next_deadline = 0;
+        _RecordFrameTime(now);
+        return;
+    }
+
+    if(_next_deadline == 0){
+        _next_deadline = _last_frame + _period_ticks;
+    }
+
+    // More than a whole period late: resync instead of bursting frames to catch up
+    if(now > _next_deadline + _period_ticks){
+        _next_deadline = now;
+    }
+
+    _SleepUntil(_next_deadline);
+
+    // Deadlines advance by whole periods so rounding never accumulates
+    _next_deadline += _period_ticks;
+
+    _RecordFrameTime(SDL_GetPerformanceCounter());
+}
+
+void _SleepUntil(Uint64 deadline){
+
+    Uint64 now = SDL_GetPerformanceCounter();
+
+    // Coarse sleep while more than the margin remains
+    while(now < deadline){
+        double remaining_ms = (double)(deadline - now) / _ticks_per_ms;
+        double sleep_ms = floor(remaining_ms - _sleep_margin_ms);
+        if(sleep_ms < 1.0) break;
+
+        SDL_Delay((Uint32)sleep_ms);
+        Uint64 woke = SDL_GetPerformanceCounter();
+        double slept_ms = (double)(woke - now) / _ticks_per_ms;
+        _slept_ms += slept_ms;
+
+        // Grow the margin immediately on oversleep, shrink it slowly otherwise
+        double oversleep_ms = slept_ms - sleep_ms;
+        if(oversleep_ms > _sleep_margin_ms){
+            _sleep_margin_ms = oversleep_ms;
+        } else {
+            _sleep_margin_ms = _sleep_margin_ms * 0.99 + oversleep_ms * 0.01;
+        }
+        if(_sleep_margin_ms < MIN_SLEEP_MARGIN_MS) _sleep_margin_ms = MIN_SLEEP_MARGIN_MS;
+        if(_sleep_margin_ms > MAX_SLEEP_MARGIN_MS) _sleep_margin_ms = MAX_SLEEP_MARGIN_MS;
+
+        now = woke;
+    }
+
+    // Spin for the remaining fraction of a millisecond
+    Uint64 spin_start = now;
+    while(now < deadline){
+        now = SDL_GetPerformanceCounter();
+    }
+    _spun_ms += (double)(now - spin_start) / _ticks_per_ms;
+}
+
+void _RecordFrameTime(Uint64 now){
+    double frame_ms = (double)(now - _last_frame) / _ticks_per_ms;
+    _last_frame = now;
+
+    // Welford's online mean and variance
+    _num_frames += 1;
+    double delta = frame_ms - _mean_frame_ms;
+    _mean_frame_ms += delta / _num_frames;
+    _m2_frame_ms += delta * (frame_ms - _mean_frame_ms);
+
+    if(frame_ms > _max_frame_ms) _max_frame_ms = frame_ms;
+    _total_ms += frame_ms;
+}
+
+void GetFramePacerStats(struct FramePacerStats* stats){
+    stats->num_frames = _num_frames;
+    stats->mean_frame_ms = _mean_frame_ms;
+    stats->jitter_ms = _num_frames > 1 ? sqrt(_m2_frame_ms / (_num_frames - 1)) : 0.0;
+    stats->max_frame_ms = _max_frame_ms;
+    stats->slept_ms = _slept_ms;
+    stats->spun_ms = _spun_ms;
+    stats->cpu_utilisation = _total_ms > 0.0 ? 1.0 - _slept_ms / _total_ms : 0.0;
+}
+
+void ResetFramePacerStats(){
+    _num_frames = 0;
+    _mean_frame_ms = 0.0;
+    _m2_frame_ms = 0.0;
+    _max_frame_ms = 0.0;
+    _total_ms = 0.0;
+    _slept_ms = 0.0;
+    _spun_ms = 0.0;
+}
+
+void PrintFramePacerStats(const char* label){
+    struct FramePacerStats stats = {0};
+    GetFramePacerStats(&stats);
+    printf("FRAME PACER (%s)\n{\n", label);
+    if(_target_hz == FRAME_PACER_UNLIMITED){
+        printf("\tTarget: unlimited\n");
+    } else {
+        printf("\tTarget: %.2f Hz\n", _target_hz);
+    }
+    printf("\tFrames: %llu\n", (unsigned long long)stats.num_frames);
+    printf("\tMean frame time: %.3f ms\n", stats.mean_frame_ms);
+    printf("\tJitter: %.3f ms\n", stats.jitter_ms);
+    printf("\tMax frame time: %.3f ms\n", stats.max_frame_ms);
+    printf("\tSlept: %.1f ms, spun: %.1f ms\n", stats.slept_ms, stats.spun_ms);
+    printf("\tCPU utilisation: %.1f%%\n", stats.cpu_utilisation * 100.0);
+    printf("}\n\n");
+}
@@ -0,0 +1,31 @@
+#ifndef _VREND_PACER_H_
+#define _VREND_PACER_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <SDL2/SDL.h>
+#include <vulkan/vulkan.h>
+
+// Target rate of 0 means unlimited
+#define FRAME_PACER_UNLIMITED 0.0
+
+struct FramePacerStats {
+    uint64_t                                num_frames;
+    double                                  mean_frame_ms;
+    double                                  jitter_ms;              // Standard deviation of frame time
+    double                                  max_frame_ms;
+    double                                  slept_ms;
+    double                                  spun_ms;
+    double                                  cpu_utilisation;        // Fraction of wall time not spent sleeping
+};
+
+void InitFramePacer(double target_hz);
+void SetFramePacerTarget(double target_hz);
+double GetFramePacerTarget();
+void PaceFrame(VkPresentModeKHR present_mode, int refresh_hz);
+void GetFramePacerStats(struct FramePacerStats* stats);
+void ResetFramePacerStats();
+void PrintFramePacerStats(const char* label);
+
+#endif
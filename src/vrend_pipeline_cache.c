@@ -0,0 +1,147 @@
+#ifdef _WIN32
+    #include <windows.h>
+#endif
+
+#include "vrend.h"
+#include "vrend_pipeline_cache.h"
+#include "vrend_host_alloc.h"
+
+// Written in front of the driver's blob
+#define PIPELINE_CACHE_MAGIC 0x43505256    // "VRPC"
+#define PIPELINE_CACHE_VERSION 1
+
+struct PipelineCacheFileHeader {
+    uint32_t                                magic;
+    uint32_t                                version;
+    uint64_t                                data_size;
+    uint64_t                                checksum;               // FNV-1a of the data
+};
+
+// Layout of the header Vulkan puts in front of every cache blob
+struct VulkanPipelineCacheHeader {
+    uint32_t                                header_size;
+    uint32_t                                header_version;
+    uint32_t                                vendor_id;
+    uint32_t                                device_id;
+    uint8_t                                 uuid[VK_UUID_SIZE];
+};
+
+uint64_t _HashBytes(const uint8_t* data, size_t size);
+uint8_t* _ReadCacheFile(const char* path, VkPhysicalDeviceProperties* properties, size_t* size);
+
+VkBool32 LoadPipelineCache(
+            VkDevice device,
+            VkPhysicalDeviceProperties* properties,
+            const char* path,
+            VkPipelineCache* cache
+){
+    size_t size = 0;
+    uint8_t* data = path != NULL ? _ReadCacheFile(path, properties, &size) : NULL;
+
+    VkPipelineCacheCreateInfo cache_ci = {0};
+    cache_ci.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+    cache_ci.pNext = NULL;
+    cache_ci.flags = 0;
+    cache_ci.initialDataSize = size;
+    cache_ci.pInitialData = data;
+    VK_CHECK(vkCreatePipelineCache, device, &cache_ci, GetHostAllocator(), cache);
+
+    free(data);
+    return data != NULL;
+}
+
+void SavePipelineCache(VkDevice device, VkPipelineCache cache, const char* path){
+    if(path == NULL || cache == NULL) return;
+
+    size_t size = 0;
+    VK_CHECK_S(vkGetPipelineCacheData, device, cache, &size, NULL);
+    if(size == 0) return;
+    uint8_t* data = malloc(size);
+    VK_CHECK_S(vkGetPipelineCacheData, device, cache, &size, data);
+
+    struct PipelineCacheFileHeader header = {0};
+    header.magic = PIPELINE_CACHE_MAGIC;
+    header.version = PIPELINE_CACHE_VERSION;
+    header.data_size = size;
+    header.checksum = _HashBytes(data, size);
+
+    size_t tmp_path_length = strlen(path) + 5;
+    char* tmp_path = malloc(tmp_path_length);
+    snprintf(tmp_path, tmp_path_length, "%s.tmp", path);
+
+    FILE* file = fopen(tmp_path, "wb");
+    VkBool32 written = VK_FALSE;
+    if(file != NULL){
+        written = fwrite(&header, sizeof(header), 1, file) == 1 && fwrite(data, 1, size, file) == size;
+        written = fclose(file) == 0 && written;
+    }
+
+    if(written){
+        #ifdef _WIN32
+            written = MoveFileExA(tmp_path, path, MOVEFILE_REPLACE_EXISTING) != 0;
+        #else
+            written = rename(tmp_path, path) == 0;
+        #endif
+    }
+    if(!written){
+        fprintf(stderr, "WARNING: failed to save pipeline cache to %s\n", path);
+        remove(tmp_path);
+    }
+
+    free(tmp_path);
+    free(data);
+}
+
+uint64_t _HashBytes(const uint8_t* data, size_t size){
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for(size_t i = 0; i < size; i ++){
+        hash ^= data[i];
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+// Returns NULL for a missing, corrupt or stale file
+uint8_t* _ReadCacheFile(const char* path, VkPhysicalDeviceProperties* properties, size_t* size){
+    FILE* file = fopen(path, "rb");
+    if(file == NULL){
+        return NULL;
+    }
+
+    struct PipelineCacheFileHeader header = {0};
+    VkBool32 valid = fread(&header, sizeof(header), 1, file) == 1;
+    valid = valid && header.magic == PIPELINE_CACHE_MAGIC && header.version == PIPELINE_CACHE_VERSION;
+    valid = valid && header.data_size >= sizeof(struct VulkanPipelineCacheHeader);
+    valid = valid && header.data_size <= MAX_PIPELINE_CACHE_SIZE;
+
+    uint8_t* data = NULL;
+    if(valid){
+        data = malloc(header.data_size);
+        valid = fread(data, 1, header.data_size, file) == header.data_size;
+    }
+    fclose(file);
+
+    if(valid){
+        valid = _HashBytes(data, header.data_size) == header.checksum;
+    }
+
+    // A cache from another driver or GPU is useless, and some drivers do not reject it themselves
+    if(valid){
+        struct VulkanPipelineCacheHeader vk_header = {0};
+        memcpy(&vk_header, data, sizeof(vk_header));
+        valid = vk_header.header_size >= sizeof(vk_header);
+        valid = valid && vk_header.header_version == VK_PIPELINE_CACHE_HEADER_VERSION_ONE;
+        valid = valid && vk_header.vendor_id == properties->vendorID;
+        valid = valid && vk_header.device_id == properties->deviceID;
+        valid = valid && memcmp(vk_header.uuid, properties->pipelineCacheUUID, VK_UUID_SIZE) == 0;
+    }
+
+    if(!valid){
+        fprintf(stderr, "WARNING: discarding stale or corrupt pipeline cache %s\n", path);
+        free(data);
+        return NULL;
+    }
+
+    *size = header.data_size;
+    return data;
+}
@@ -0,0 +1,28 @@
+#ifndef _VREND_PIPELINE_CACHE_H_
+#define _VREND_PIPELINE_CACHE_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vulkan/vulkan.h>
+
+#define DEFAULT_PIPELINE_CACHE_PATH "pipeline_cache.bin"
+
+// Largest blob accepted from disk
+#define MAX_PIPELINE_CACHE_SIZE (64 * 1024 * 1024)
+
+// Creates the cache from the file at path when its checksum and Vulkan header
+// match the device, otherwise creates an empty one. path may be NULL.
+// Returns VK_TRUE if the cache was loaded from disk.
+VkBool32 LoadPipelineCache(
+    VkDevice device,
+    VkPhysicalDeviceProperties* properties,
+    const char* path,
+    VkPipelineCache* cache
+);
+
+// Writes to a temporary file first and renames it over path, so a crash
+// never leaves a half written cache behind
+void SavePipelineCache(VkDevice device, VkPipelineCache cache, const char* path);
+
+#endif
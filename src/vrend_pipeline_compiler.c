@@ -0,0 +1,145 @@
+#include "vrend.h"
+#include "vrend_pipeline_compiler.h"
+#include "vrend_host_alloc.h"
+
+static VkDevice                         _device = NULL;
+static VkPipelineCache                  _cache = NULL;
+static SDL_atomic_t                     _num_pending = {0};
+
+void _CompileJob(void* data, uint32_t worker_index);
+
+void InitPipelineCompiler(VkDevice device, VkPipelineCache cache){
+    _device = device;
+    _cache = cache;
+    SDL_AtomicSet(&_num_pending, 0);
+}
+
+VkResult CreatePipeline(const struct PipelineDescription* description, VkPipeline* pipeline, double* compile_ms){
+
+    Uint64 start = SDL_GetPerformanceCounter();
+
+    VkSpecializationMapEntry vert_map_entries[MAX_SPECIALIZATION_CONSTANTS];
+    VkSpecializationMapEntry frag_map_entries[MAX_SPECIALIZATION_CONSTANTS];
+    VkSpecializationInfo vert_specialization = {0};
+    VkSpecializationInfo frag_specialization = {0};
+
+    VkPipelineShaderStageCreateInfo shader_stages[] = {
+        GetShaderStageCI(
+            VK_SHADER_STAGE_VERTEX_BIT, description->vert_shader,
+            GetSpecializationConstantsInfo(&description->vert_constants, vert_map_entries, &vert_specialization)
+        ),
+        GetShaderStageCI(
+            VK_SHADER_STAGE_FRAGMENT_BIT, description->frag_shader,
+            GetSpecializationConstantsInfo(&description->frag_constants, frag_map_entries, &frag_specialization)
+        )
+    };
+
+    VkPipelineVertexInputStateCreateInfo vertex_input_ci = GetVertexInputCI();
+    VkPipelineInputAssemblyStateCreateInfo input_assembly_ci = GetInputAssemblyCI(description->topology);
+    VkPipelineRasterizationStateCreateInfo rasterization_ci = GetRasterizationCI(description->polygon_mode);
+    VkPipelineMultisampleStateCreateInfo multisample_ci = GetMultisampleCI();
+
+    VkPipelineColorBlendAttachmentState color_blend_attachment = GetColorBlendAttachmentState();
+
+    VkPipelineColorBlendStateCreateInfo color_blend_ci = {0};
+    color_blend_ci.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+    color_blend_ci.pNext = NULL;
+    color_blend_ci.logicOpEnable = VK_FALSE;
+    color_blend_ci.logicOp = VK_LOGIC_OP_COPY;
+    color_blend_ci.attachmentCount = 1;
+    color_blend_ci.pAttachments = &color_blend_attachment;
+
+    VkPipelineViewportStateCreateInfo viewport_ci = {0};
+    viewport_ci.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+    viewport_ci.pNext = NULL;
+    viewport_ci.viewportCount = 1;
+    viewport_ci.pViewports = NULL;
+    viewport_ci.scissorCount = 1;
+    viewport_ci.pScissors = NULL;
+
+    // Set while recording so the pipeline survives a resize
+    VkDynamicState dynamic_states[] = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
+    VkPipelineDynamicStateCreateInfo dynamic_state_ci = {0};
+    dynamic_state_ci.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+    dynamic_state_ci.pNext = NULL;
+    dynamic_state_ci.dynamicStateCount = 2;
+    dynamic_state_ci.pDynamicStates = dynamic_states;
+
+    VkGraphicsPipelineCreateInfo pipeline_ci = {0};
+    pipeline_ci.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+    pipeline_ci.pNext = NULL;
+    pipeline_ci.stageCount = 2;
+    pipeline_ci.pStages = shader_stages;
+    pipeline_ci.pVertexInputState = &vertex_input_ci;
+    pipeline_ci.pViewportState = &viewport_ci;
+    pipeline_ci.pRasterizationState = &rasterization_ci;
+    pipeline_ci.pMultisampleState = &multisample_ci;
+    pipeline_ci.pColorBlendState = &color_blend_ci;
+    pipeline_ci.pInputAssemblyState = &input_assembly_ci;
+    pipeline_ci.pDynamicState = &dynamic_state_ci;
+    pipeline_ci.layout = description->layout;
+    pipeline_ci.renderPass = description->render_pass;
+    pipeline_ci.subpass = description->subpass;
+    pipeline_ci.basePipelineHandle = NULL;
+
+    // The cache is internally synchronized, so workers share it without a lock
+    VkResult result = vkCreateGraphicsPipelines(_device, _cache, 1, &pipeline_ci, GetHostAllocator(), pipeline);
+
+    if(compile_ms != NULL){
+        *compile_ms = (double)(SDL_GetPerformanceCounter() - start) / SDL_GetPerformanceFrequency() * 1000;
+    }
+    return result;
+}
+
+struct PipelineFuture* CompilePipelineAsync(const struct PipelineDescription* description){
+    struct PipelineFuture* future = calloc(1, sizeof(struct PipelineFuture));
+    future->description = *description;
+    SDL_AtomicSet(&future->status, PIPELINE_STATUS_PENDING);
+
+    SDL_AtomicAdd(&_num_pending, 1);
+    SubmitBackgroundJob(_CompileJob, future, &future->counter);
+    return future;
+}
+
+enum PipelineStatus GetPipelineStatus(struct PipelineFuture* future){
+    return (enum PipelineStatus)SDL_AtomicGet(&future->status);
+}
+
+VkPipeline GetPipelineIfReady(struct PipelineFuture* future){
+    if(GetPipelineStatus(future) != PIPELINE_STATUS_READY){
+        return NULL;
+    }
+    return future->pipeline;
+}
+
+void WaitPipeline(struct PipelineFuture* future){
+    WaitJobCounter(&future->counter);
+}
+
+double GetPipelineCompileMs(struct PipelineFuture* future){
+    return GetPipelineStatus(future) == PIPELINE_STATUS_PENDING ? 0.0 : future->compile_ms;
+}
+
+void ReleasePipelineFuture(struct PipelineFuture* future){
+    if(future == NULL) return;
+    WaitJobCounter(&future->counter);
+    free(future);
+}
+
+uint32_t GetPendingPipelineCompiles(){
+    return (uint32_t)SDL_AtomicGet(&_num_pending);
+}
+
+void _CompileJob(void* data, uint32_t worker_index){
+    struct PipelineFuture* future = data;
+
+    future->result = CreatePipeline(&future->description, &future->pipeline, &future->compile_ms);
+    if(future->result != VK_SUCCESS){
+        fprintf(stderr, "WARNING: pipeline compile failed: %s\n", STR_VK_RESULT(future->result));
+        future->pipeline = NULL;
+    }
+
+    // The atomic publishes the fields written above
+    SDL_AtomicSet(&future->status, future->result == VK_SUCCESS ? PIPELINE_STATUS_READY : PIPELINE_STATUS_FAILED);
+    SDL_AtomicAdd(&_num_pending, -1);
+}
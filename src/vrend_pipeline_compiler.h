@@ -0,0 +1,65 @@
+#ifndef _VREND_PIPELINE_COMPILER_H_
+#define _VREND_PIPELINE_COMPILER_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <SDL2/SDL.h>
+#include <vulkan/vulkan.h>
+
+#include "vrend_jobs.h"
+#include "vrend_specialization.h"
+
+enum PipelineStatus {
+    PIPELINE_STATUS_PENDING,
+    PIPELINE_STATUS_READY,
+    PIPELINE_STATUS_FAILED
+};
+
+// Everything a graphics pipeline is built from, viewport and scissor are
+// always dynamic. The handles must stay alive until the compile finished.
+struct PipelineDescription {
+    VkShaderModule                          vert_shader;
+    VkShaderModule                          frag_shader;
+    VkPipelineLayout                        layout;
+    VkRenderPass                            render_pass;
+    uint32_t                                subpass;
+    VkPrimitiveTopology                     topology;
+    VkPolygonMode                           polygon_mode;
+    struct SpecializationConstants          vert_constants;
+    struct SpecializationConstants          frag_constants;
+};
+
+// Handle to a compile queued with CompilePipelineAsync. Only read it through
+// the functions below, the fields are written by a job worker.
+struct PipelineFuture {
+    struct PipelineDescription              description;
+    VkPipeline                              pipeline;
+    VkResult                                result;
+    double                                  compile_ms;
+    SDL_atomic_t                            status;
+    struct JobCounter                       counter;
+};
+
+// Every pipeline is compiled against cache, which may be NULL
+void InitPipelineCompiler(VkDevice device, VkPipelineCache cache);
+
+// Compiles on the calling thread
+VkResult CreatePipeline(const struct PipelineDescription* description, VkPipeline* pipeline, double* compile_ms);
+
+// Queues the compile on the job pool and returns straight away
+struct PipelineFuture* CompilePipelineAsync(const struct PipelineDescription* description);
+enum PipelineStatus GetPipelineStatus(struct PipelineFuture* future);
+
+// NULL until the compile has succeeded, never blocks
+VkPipeline GetPipelineIfReady(struct PipelineFuture* future);
+void WaitPipeline(struct PipelineFuture* future);
+double GetPipelineCompileMs(struct PipelineFuture* future);
+
+// Waits for the compile and frees the handle. The pipeline is not destroyed,
+// it belongs to whoever took it with GetPipelineIfReady.
+void ReleasePipelineFuture(struct PipelineFuture* future);
+
+// Compiles queued or running right now
+uint32_t GetPendingPipelineCompiles();
+
+#endif
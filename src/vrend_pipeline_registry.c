@@ -0,0 +1,200 @@
+#include "vrend.h"
+#include "vrend_deletion.h"
+#include "vrend_pipeline_registry.h"
+#include "vrend_host_alloc.h"
+
+#define FNV_OFFSET_BASIS 0xcbf29ce484222325ull
+#define FNV_PRIME 0x100000001b3ull
+
+enum PipelineSlot {
+    PIPELINE_SLOT_EMPTY,
+    PIPELINE_SLOT_USED,
+    PIPELINE_SLOT_REMOVED                                           // Keeps probe chains intact
+};
+
+struct PipelineEntry {
+    enum PipelineSlot                       slot;
+    uint64_t                                hash;
+    struct PipelineDescription              description;
+    struct PipelineFuture*                  future;                 // NULL once the compile was collected
+    enum PipelineStatus                     status;
+    VkPipeline                              pipeline;
+};
+
+static VkDevice                         _device = NULL;
+static struct PipelineEntry             _entries[PIPELINE_REGISTRY_SIZE] = {0};
+static struct PipelineRegistryStats     _stats = {0};
+
+uint64_t _HashField(uint64_t hash, const void* data, size_t size);
+uint64_t _HashConstants(uint64_t hash, const struct SpecializationConstants* constants);
+VkBool32 _MatchDescription(const struct PipelineDescription* a, const struct PipelineDescription* b);
+struct PipelineEntry* _FindPipelineEntry(const struct PipelineDescription* description, uint64_t hash, VkBool32 insert);
+void _CollectCompile(struct PipelineEntry* entry, VkBool32 wait);
+void _EvictEntry(struct PipelineEntry* entry, uint64_t timeline_value);
+
+void InitPipelineRegistry(VkDevice device){
+    _device = device;
+    memset(_entries, 0, sizeof(_entries));
+    memset(&_stats, 0, sizeof(_stats));
+}
+
+void FreePipelineRegistry(){
+    for(uint32_t i = 0; i < PIPELINE_REGISTRY_SIZE; i ++){
+        if(_entries[i].slot != PIPELINE_SLOT_USED) continue;
+        _CollectCompile(&_entries[i], VK_TRUE);
+        vkDestroyPipeline(_device, _entries[i].pipeline, GetHostAllocator());
+        _entries[i].slot = PIPELINE_SLOT_EMPTY;
+    }
+    _stats.num_pipelines = 0;
+}
+
+uint64_t HashPipelineDescription(const struct PipelineDescription* description){
+    uint64_t hash = FNV_OFFSET_BASIS;
+    hash = _HashField(hash, &description->vert_shader, sizeof(description->vert_shader));
+    hash = _HashField(hash, &description->frag_shader, sizeof(description->frag_shader));
+    hash = _HashField(hash, &description->layout, sizeof(description->layout));
+    hash = _HashField(hash, &description->render_pass, sizeof(description->render_pass));
+    hash = _HashField(hash, &description->subpass, sizeof(description->subpass));
+    hash = _HashField(hash, &description->topology, sizeof(description->topology));
+    hash = _HashField(hash, &description->polygon_mode, sizeof(description->polygon_mode));
+    hash = _HashConstants(hash, &description->vert_constants);
+    hash = _HashConstants(hash, &description->frag_constants);
+    return hash;
+}
+
+enum PipelineStatus GetPipeline(const struct PipelineDescription* description, VkPipeline* pipeline){
+    uint64_t hash = HashPipelineDescription(description);
+    struct PipelineEntry* entry = _FindPipelineEntry(description, hash, VK_FALSE);
+
+    if(entry == NULL){
+        entry = _FindPipelineEntry(description, hash, VK_TRUE);
+        if(entry == NULL){
+            fprintf(stderr, "ERROR: pipeline registry is full, raise PIPELINE_REGISTRY_SIZE\n");
+            exit(EXIT_FAILURE);
+        }
+        entry->slot = PIPELINE_SLOT_USED;
+        entry->hash = hash;
+        entry->description = *description;
+        entry->future = CompilePipelineAsync(description);
+        entry->status = PIPELINE_STATUS_PENDING;
+        entry->pipeline = NULL;
+        _stats.misses += 1;
+        _stats.num_pipelines += 1;
+        _stats.num_pending += 1;
+        return PIPELINE_STATUS_PENDING;
+    }
+
+    _CollectCompile(entry, VK_FALSE);
+    if(entry->status == PIPELINE_STATUS_PENDING){
+        _stats.waits += 1;
+    } else {
+        _stats.hits += 1;
+    }
+    if(entry->status == PIPELINE_STATUS_READY){
+        *pipeline = entry->pipeline;
+    }
+    return entry->status;
+}
+
+void WaitPipelines(){
+    for(uint32_t i = 0; i < PIPELINE_REGISTRY_SIZE; i ++){
+        if(_entries[i].slot == PIPELINE_SLOT_USED){
+            _CollectCompile(&_entries[i], VK_TRUE);
+        }
+    }
+}
+
+void EvictPipelines(VkRenderPass render_pass, uint64_t timeline_value){
+    for(uint32_t i = 0; i < PIPELINE_REGISTRY_SIZE; i ++){
+        struct PipelineEntry* entry = &_entries[i];
+        if(entry->slot != PIPELINE_SLOT_USED || entry->description.render_pass != render_pass) continue;
+        _EvictEntry(entry, timeline_value);
+    }
+}
+
+void EvictShaderPipelines(VkShaderModule module, uint64_t timeline_value){
+    for(uint32_t i = 0; i < PIPELINE_REGISTRY_SIZE; i ++){
+        struct PipelineEntry* entry = &_entries[i];
+        if(entry->slot != PIPELINE_SLOT_USED) continue;
+        if(entry->description.vert_shader != module && entry->description.frag_shader != module) continue;
+        _EvictEntry(entry, timeline_value);
+    }
+}
+
+void GetPipelineRegistryStats(struct PipelineRegistryStats* stats){
+    *stats = _stats;
+}
+
+uint64_t _HashField(uint64_t hash, const void* data, size_t size){
+    const uint8_t* bytes = data;
+    for(size_t i = 0; i < size; i ++){
+        hash ^= bytes[i];
+        hash *= FNV_PRIME;
+    }
+    return hash;
+}
+
+// Only the constants in use, unused slots may hold anything
+uint64_t _HashConstants(uint64_t hash, const struct SpecializationConstants* constants){
+    hash = _HashField(hash, &constants->count, sizeof(constants->count));
+    hash = _HashField(hash, constants->ids, constants->count * sizeof(uint32_t));
+    hash = _HashField(hash, constants->values, constants->count * sizeof(uint32_t));
+    return hash;
+}
+
+VkBool32 _MatchDescription(const struct PipelineDescription* a, const struct PipelineDescription* b){
+    return a->vert_shader == b->vert_shader
+        && a->frag_shader == b->frag_shader
+        && a->layout == b->layout
+        && a->render_pass == b->render_pass
+        && a->subpass == b->subpass
+        && a->topology == b->topology
+        && a->polygon_mode == b->polygon_mode
+        && MatchSpecializationConstants(&a->vert_constants, &b->vert_constants)
+        && MatchSpecializationConstants(&a->frag_constants, &b->frag_constants);
+}
+
+// Linear probing. Lookups skip removed slots, inserts reuse the first one.
+struct PipelineEntry* _FindPipelineEntry(const struct PipelineDescription* description, uint64_t hash, VkBool32 insert){
+    for(uint32_t i = 0; i < PIPELINE_REGISTRY_SIZE; i ++){
+        struct PipelineEntry* entry = &_entries[(hash + i) & (PIPELINE_REGISTRY_SIZE - 1)];
+        if(insert){
+            if(entry->slot != PIPELINE_SLOT_USED) return entry;
+            continue;
+        }
+        if(entry->slot == PIPELINE_SLOT_EMPTY) return NULL;
+        if(entry->slot == PIPELINE_SLOT_USED && entry->hash == hash && _MatchDescription(&entry->description, description)){
+            return entry;
+        }
+    }
+    return NULL;
+}
+
+void _CollectCompile(struct PipelineEntry* entry, VkBool32 wait){
+    if(entry->future == NULL) return;
+
+    if(wait){
+        WaitPipeline(entry->future);
+    }
+    entry->status = GetPipelineStatus(entry->future);
+    if(entry->status == PIPELINE_STATUS_PENDING) return;
+
+    entry->pipeline = GetPipelineIfReady(entry->future);
+    double compile_ms = GetPipelineCompileMs(entry->future);
+    _stats.compile_ms += compile_ms;
+    if(compile_ms > _stats.max_compile_ms) _stats.max_compile_ms = compile_ms;
+    _stats.num_pending -= 1;
+
+    ReleasePipelineFuture(entry->future);
+    entry->future = NULL;
+}
+
+// The compile may still read the description, so it is waited for
+void _EvictEntry(struct PipelineEntry* entry, uint64_t timeline_value){
+    _CollectCompile(entry, VK_TRUE);
+    if(entry->pipeline != NULL){
+        QueueDeletion((struct Deletion){ .type = DELETION_PIPELINE, .handle.pipeline = entry->pipeline }, timeline_value);
+    }
+    entry->slot = PIPELINE_SLOT_REMOVED;
+    _stats.num_pipelines -= 1;
+}
@@ -0,0 +1,47 @@
+#ifndef _VREND_PIPELINE_REGISTRY_H_
+#define _VREND_PIPELINE_REGISTRY_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <vulkan/vulkan.h>
+
+#include "vrend_pipeline_compiler.h"
+
+// Power of two, one pipeline per slot
+#define PIPELINE_REGISTRY_SIZE 256
+
+struct PipelineRegistryStats {
+    uint64_t                                hits;                   // Lookups answered with a compiled pipeline
+    uint64_t                                misses;                 // Lookups that queued a compile
+    uint64_t                                waits;                  // Lookups of a compile still in flight
+    uint32_t                                num_pipelines;
+    uint32_t                                num_pending;
+    double                                  compile_ms;             // Worker time of all compiles
+    double                                  max_compile_ms;
+};
+
+// Only used from the thread that draws
+void InitPipelineRegistry(VkDevice device);
+
+// Waits for compiles in flight and destroys every pipeline right away
+void FreePipelineRegistry();
+
+// Field by field, so padding never changes the result
+uint64_t HashPipelineDescription(const struct PipelineDescription* description);
+
+// Never blocks. An unknown description queues a compile and reports
+// PIPELINE_STATUS_PENDING, pipeline is only set for PIPELINE_STATUS_READY.
+enum PipelineStatus GetPipeline(const struct PipelineDescription* description, VkPipeline* pipeline);
+
+void WaitPipelines();
+
+// Drops every pipeline built for render_pass. They go through the deletion
+// queue with timeline_value, compiles using it are waited for first.
+void EvictPipelines(VkRenderPass render_pass, uint64_t timeline_value);
+
+// Same for every pipeline built from module, as either stage
+void EvictShaderPipelines(VkShaderModule module, uint64_t timeline_value);
+
+void GetPipelineRegistryStats(struct PipelineRegistryStats* stats);
+
+#endif
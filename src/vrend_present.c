@@ -0,0 +1,178 @@
+#include "vrend_present.h"
+#include "vrend_latency.h"
+
+static SDL_Thread*                      _thread = NULL;
+static VkQueue                          _queue = NULL;
+static VkBool32                         _queue_shared = VK_FALSE;
+static SDL_mutex*                       _queue_mutex = NULL;        // Guards _queue when it is shared
+static SDL_mutex*                       _mutex = NULL;              // Guards everything below
+static SDL_cond*                        _work_cond = NULL;          // Signaled when a request is queued
+static SDL_cond*                        _done_cond = NULL;          // Signaled when a request was presented
+static struct PresentRequest            _requests[PRESENT_QUEUE_SIZE] = {0};
+static uint32_t                         _requests_head = 0;
+static uint32_t                         _requests_count = 0;
+static uint64_t                         _next_id = 1;
+static uint64_t                         _submitted_id = 0;          // Requests are presented in id order
+static VkResult                         _result = VK_SUCCESS;
+static double                           _present_ms = 0.0;
+static VkBool32                         _quit = VK_FALSE;
+
+int _PresentThread(void* data);
+
+void InitPresentThread(VkQueue queue, VkBool32 queue_shared){
+    if(_thread != NULL) return;
+
+    _queue = queue;
+    _queue_shared = queue_shared;
+    _queue_mutex = SDL_CreateMutex();
+    _mutex = SDL_CreateMutex();
+    _work_cond = SDL_CreateCond();
+    _done_cond = SDL_CreateCond();
+    if(_queue_mutex == NULL || _mutex == NULL || _work_cond == NULL || _done_cond == NULL){
+        fprintf(stderr, "SDL2 ERROR: failed to create present thread sync objects: %s\n", SDL_GetError());
+        exit(EXIT_FAILURE);
+    }
+
+    _requests_head = 0;
+    _requests_count = 0;
+    _result = VK_SUCCESS;
+    _present_ms = 0.0;
+    _quit = VK_FALSE;
+
+    _thread = SDL_CreateThread(_PresentThread, "vrend_present", NULL);
+    if(_thread == NULL){
+        fprintf(stderr, "SDL2 ERROR: failed to create present thread: %s\n", SDL_GetError());
+        exit(EXIT_FAILURE);
+    }
+}
+
+void FreePresentThread(){
+    if(_thread == NULL) return;
+
+    SDL_LockMutex(_mutex);
+    _quit = VK_TRUE;
+    SDL_CondSignal(_work_cond);
+    SDL_UnlockMutex(_mutex);
+
+    SDL_WaitThread(_thread, NULL);
+    _thread = NULL;
+
+    SDL_DestroyCond(_done_cond);
+    SDL_DestroyCond(_work_cond);
+    SDL_DestroyMutex(_mutex);
+    SDL_DestroyMutex(_queue_mutex);
+    _queue_mutex = NULL;
+}
+
+VkBool32 IsPresentThreadRunning(){
+    return _thread != NULL;
+}
+
+uint64_t QueuePresent(struct PresentRequest* request){
+    SDL_LockMutex(_mutex);
+    while(_requests_count == PRESENT_QUEUE_SIZE){
+        SDL_CondWait(_done_cond, _mutex);
+    }
+    _requests[(_requests_head + _requests_count) % PRESENT_QUEUE_SIZE] = *request;
+    _requests_count += 1;
+    uint64_t id = _next_id;
+    _next_id += 1;
+    SDL_CondSignal(_work_cond);
+    SDL_UnlockMutex(_mutex);
+    return id;
+}
+
+void WaitPresentSubmitted(uint64_t id){
+    if(_thread == NULL) return;
+
+    SDL_LockMutex(_mutex);
+    while(_submitted_id < id){
+        SDL_CondWait(_done_cond, _mutex);
+    }
+    SDL_UnlockMutex(_mutex);
+}
+
+void WaitPresentIdle(){
+    if(_thread == NULL) return;
+
+    SDL_LockMutex(_mutex);
+    while(_requests_count > 0 || _submitted_id + 1 < _next_id){
+        SDL_CondWait(_done_cond, _mutex);
+    }
+    SDL_UnlockMutex(_mutex);
+}
+
+VkResult TakePresentResult(){
+    if(_thread == NULL) return VK_SUCCESS;
+
+    SDL_LockMutex(_mutex);
+    VkResult result = _result;
+    _result = VK_SUCCESS;
+    SDL_UnlockMutex(_mutex);
+    return result;
+}
+
+double GetPresentCallMs(){
+    if(_thread == NULL) return _present_ms;
+
+    SDL_LockMutex(_mutex);
+    double present_ms = _present_ms;
+    SDL_UnlockMutex(_mutex);
+    return present_ms;
+}
+
+void LockPresentQueue(){
+    if(_queue_shared && _queue_mutex != NULL) SDL_LockMutex(_queue_mutex);
+}
+
+void UnlockPresentQueue(){
+    if(_queue_shared && _queue_mutex != NULL) SDL_UnlockMutex(_queue_mutex);
+}
+
+int _PresentThread(void* data){
+
+    SDL_LockMutex(_mutex);
+    while(VK_TRUE){
+        while(_requests_count == 0 && !_quit){
+            SDL_CondWait(_work_cond, _mutex);
+        }
+        if(_requests_count == 0 && _quit){
+            break;
+        }
+
+        // The slot stays reserved until presented so QueuePresent cannot overwrite it
+        struct PresentRequest request = _requests[_requests_head];
+        SDL_UnlockMutex(_mutex);
+
+        VkPresentInfoKHR present_info = {0};
+        present_info.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
+        present_info.pNext = NULL;
+        present_info.swapchainCount = 1;
+        present_info.pSwapchains = &request.swap_chain;
+        present_info.waitSemaphoreCount = 1;
+        present_info.pWaitSemaphores = &request.wait_semaphore;
+        present_info.pImageIndices = &request.image_index;
+
+        Uint64 start = SDL_GetPerformanceCounter();
+        LockPresentQueue();
+        VkResult result = vkQueuePresentKHR(_queue, &present_info);
+        UnlockPresentQueue();
+        if(request.input_time != 0){
+            RecordInputToPresent(request.input_time, SDL_GetPerformanceCounter());
+        }
+        double present_ms = (double)(SDL_GetPerformanceCounter() - start) / SDL_GetPerformanceFrequency() * 1000;
+
+        SDL_LockMutex(_mutex);
+        _requests_head = (_requests_head + 1) % PRESENT_QUEUE_SIZE;
+        _requests_count -= 1;
+        _submitted_id += 1;
+        if(result != VK_SUCCESS && _result == VK_SUCCESS){
+            _result = result;
+        }
+        _present_ms = _present_ms == 0.0 ? present_ms : _present_ms * 0.9 + present_ms * 0.1;
+        SDL_CondBroadcast(_done_cond);
+    }
+    SDL_UnlockMutex(_mutex);
+
+    return 0;
+}
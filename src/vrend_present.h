@@ -0,0 +1,45 @@
+#ifndef _VREND_PRESENT_H_
+#define _VREND_PRESENT_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <SDL2/SDL.h>
+#include <vulkan/vulkan.h>
+
+#define PRESENT_QUEUE_SIZE 8
+
+struct PresentRequest {
+    VkSwapchainKHR                          swap_chain;
+    uint32_t                                image_index;
+    VkSemaphore                             wait_semaphore;
+    Uint64                                  input_time;             // Oldest input shown by this image, 0 if none
+};
+
+// queue_shared means the queue is also used for submissions on another
+// thread, which then has to hold LockPresentQueue around them
+void InitPresentThread(VkQueue queue, VkBool32 queue_shared);
+
+// Presents everything still queued before joining the thread
+void FreePresentThread();
+VkBool32 IsPresentThreadRunning();
+
+// Hands the request to the present thread and returns its id. Only waits
+// when PRESENT_QUEUE_SIZE requests are already queued.
+uint64_t QueuePresent(struct PresentRequest* request);
+
+// Waits until the request has been passed to vkQueuePresentKHR, after which
+// its wait semaphore may be signaled again
+void WaitPresentSubmitted(uint64_t id);
+void WaitPresentIdle();
+
+// First result other than VK_SUCCESS since the last call, VK_SUCCESS if none
+VkResult TakePresentResult();
+
+// Moving average time spent inside vkQueuePresentKHR on the present thread
+double GetPresentCallMs();
+
+// No-ops unless the present thread runs on a shared queue
+void LockPresentQueue();
+void UnlockPresentQueue();
+
+#endif
@@ -0,0 +1,227 @@
+#include "vrend.h"
+#include "vrend_shader_cache.h"
+#include "vrend_host_alloc.h"
+
+#define FNV_OFFSET_BASIS 0xcbf29ce484222325ull
+#define FNV_PRIME 0x100000001b3ull
+
+struct ShaderEntry {
+    char*                                   path;
+    uint64_t                                hash;                   // FNV-1a of the code
+    size_t                                  size;
+    VkShaderModule                          module;
+    VkBool32                                shared;                 // Module is owned by an earlier entry
+    VkBool32                                replaced;               // Reloaded, only kept until taken
+};
+
+static VkDevice                         _device = NULL;
+static struct ShaderEntry*              _entries = NULL;            // Grows, every reload adds an entry until taken
+static uint32_t                         _num_entries = 0;
+static uint32_t                         _max_entries = 0;
+static struct ShaderCacheStats          _stats = {0};
+
+uint32_t* _ReadSpirv(const char* path, size_t* size);
+struct ShaderEntry* _FindShaderEntry(const char* key);
+VkShaderModule _AddEntry(const char* key, const uint32_t* code, size_t size);
+VkBool32 _IsSpirv(const uint32_t* code, size_t size);
+uint64_t _HashCode(const uint32_t* code, size_t size);
+
+void InitShaderCache(VkDevice device){
+    _device = device;
+    _num_entries = 0;
+    memset(&_stats, 0, sizeof(_stats));
+}
+
+void FreeShaderCache(){
+    for(uint32_t i = 0; i < _num_entries; i ++){
+        if(!_entries[i].shared){
+            vkDestroyShaderModule(_device, _entries[i].module, GetHostAllocator());
+        }
+        free(_entries[i].path);
+    }
+    free(_entries);
+    _entries = NULL;
+    _num_entries = 0;
+    _max_entries = 0;
+    _stats.num_modules = 0;
+    _stats.code_bytes = 0;
+}
+
+VkShaderModule GetShaderModule(const char* path){
+    struct ShaderEntry* entry = _FindShaderEntry(path);
+    if(entry != NULL){
+        _stats.hits += 1;
+        return entry->module;
+    }
+
+    Uint64 start = SDL_GetPerformanceCounter();
+
+    size_t size = 0;
+    uint32_t* code = _ReadSpirv(path, &size);
+    _stats.files_read += 1;
+    VkShaderModule module = _AddEntry(path, code, size);
+    free(code);
+
+    _stats.load_ms += (double)(SDL_GetPerformanceCounter() - start) / SDL_GetPerformanceFrequency() * 1000;
+    return module;
+}
+
+VkShaderModule GetShaderModuleFromCode(const char* key, const uint32_t* code, size_t size){
+    struct ShaderEntry* entry = _FindShaderEntry(key);
+    if(entry != NULL){
+        _stats.hits += 1;
+        return entry->module;
+    }
+
+    Uint64 start = SDL_GetPerformanceCounter();
+
+    if(!_IsSpirv(code, size)){
+        fprintf(stderr, "ERROR: shader %s is not SPIR-V\n", key);
+        exit(EXIT_FAILURE);
+    }
+    VkShaderModule module = _AddEntry(key, code, size);
+
+    _stats.load_ms += (double)(SDL_GetPerformanceCounter() - start) / SDL_GetPerformanceFrequency() * 1000;
+    return module;
+}
+
+VkShaderModule ReloadShaderModule(const char* path){
+    struct ShaderEntry* entry = _FindShaderEntry(path);
+    if(entry != NULL){
+        entry->replaced = VK_TRUE;
+    }
+    return GetShaderModule(path);
+}
+
+VkShaderModule TakeReplacedShaderModule(){
+    uint32_t i = 0;
+    while(i < _num_entries){
+        struct ShaderEntry* entry = &_entries[i];
+        if(!entry->replaced){
+            i += 1;
+            continue;
+        }
+
+        VkShaderModule module = entry->shared ? NULL : entry->module;
+        size_t size = entry->size;
+        free(entry->path);
+        memmove(entry, entry + 1, sizeof(struct ShaderEntry) * (_num_entries - i - 1));
+        _num_entries -= 1;
+        if(module == NULL) continue;
+
+        // A file saved back to earlier code shares the module, which then
+        // belongs to the first entry still using it
+        VkBool32 in_use = VK_FALSE;
+        for(uint32_t j = 0; j < _num_entries; j ++){
+            if(_entries[j].shared && _entries[j].module == module){
+                _entries[j].shared = VK_FALSE;
+                in_use = VK_TRUE;
+                break;
+            }
+        }
+        if(in_use) continue;
+
+        _stats.num_modules -= 1;
+        _stats.code_bytes -= size;
+        return module;
+    }
+    return NULL;
+}
+
+void GetShaderCacheStats(struct ShaderCacheStats* stats){
+    *stats = _stats;
+}
+
+// malloc keeps the words aligned, which pCode requires
+uint32_t* _ReadSpirv(const char* path, size_t* size){
+    FILE* file = fopen(path, "rb");
+    if(file == NULL){
+        fprintf(stderr, "ERROR: failed to open shader file %s\n", path);
+        exit(EXIT_FAILURE);
+    }
+
+    fseek(file, 0, SEEK_END);
+    long file_size = ftell(file);
+    rewind(file);
+    if(file_size <= 0 || file_size % sizeof(uint32_t) != 0){
+        fprintf(stderr, "ERROR: shader file %s is %ld bytes, not a whole number of SPIR-V words\n", path, file_size);
+        exit(EXIT_FAILURE);
+    }
+
+    *size = (size_t)file_size;
+    uint32_t* code = malloc(file_size);
+    size_t read = fread(code, 1, file_size, file);
+    fclose(file);
+    if(read != (size_t)file_size){
+        fprintf(stderr, "ERROR: failed to read shader file %s\n", path);
+        exit(EXIT_FAILURE);
+    }
+    if(!_IsSpirv(code, *size)){
+        fprintf(stderr, "ERROR: shader file %s is not SPIR-V\n", path);
+        exit(EXIT_FAILURE);
+    }
+
+    return code;
+}
+
+struct ShaderEntry* _FindShaderEntry(const char* key){
+    for(uint32_t i = 0; i < _num_entries; i ++){
+        if(!_entries[i].replaced && strcmp(_entries[i].path, key) == 0){
+            return &_entries[i];
+        }
+    }
+    return NULL;
+}
+
+VkShaderModule _AddEntry(const char* key, const uint32_t* code, size_t size){
+    if(_num_entries == _max_entries){
+        _max_entries = _max_entries == 0 ? 8 : _max_entries * 2;
+        _entries = realloc(_entries, sizeof(struct ShaderEntry) * _max_entries);
+    }
+
+    struct ShaderEntry* entry = &_entries[_num_entries];
+    entry->path = malloc(strlen(key) + 1);
+    strcpy(entry->path, key);
+    entry->hash = _HashCode(code, size);
+    entry->size = size;
+    entry->module = NULL;
+    entry->shared = VK_FALSE;
+    entry->replaced = VK_FALSE;
+
+    for(uint32_t i = 0; i < _num_entries; i ++){
+        if(_entries[i].hash == entry->hash && _entries[i].size == size && !_entries[i].shared){
+            entry->module = _entries[i].module;
+            entry->shared = VK_TRUE;
+            break;
+        }
+    }
+
+    // The driver keeps its own copy of the code
+    if(entry->module == NULL){
+        VkShaderModuleCreateInfo module_ci = {0};
+        module_ci.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+        module_ci.pNext = NULL;
+        module_ci.flags = 0;
+        module_ci.codeSize = size;
+        module_ci.pCode = code;
+        VK_CHECK(vkCreateShaderModule, _device, &module_ci, GetHostAllocator(), &entry->module);
+        _stats.num_modules += 1;
+        _stats.code_bytes += size;
+    }
+    _num_entries += 1;
+    return entry->module;
+}
+
+VkBool32 _IsSpirv(const uint32_t* code, size_t size){
+    return size >= sizeof(uint32_t) && size % sizeof(uint32_t) == 0 && code[0] == SPIRV_MAGIC;
+}
+
+uint64_t _HashCode(const uint32_t* code, size_t size){
+    const uint8_t* bytes = (const uint8_t*)code;
+    uint64_t hash = FNV_OFFSET_BASIS;
+    for(size_t i = 0; i < size; i ++){
+        hash ^= bytes[i];
+        hash *= FNV_PRIME;
+    }
+    return hash;
+}
@@ -0,0 +1,47 @@
+#ifndef _VREND_SHADER_CACHE_H_
+#define _VREND_SHADER_CACHE_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <SDL2/SDL.h>
+#include <vulkan/vulkan.h>
+
+#define SPIRV_MAGIC 0x07230203
+
+struct ShaderCacheStats {
+    uint32_t                                num_modules;
+    uint64_t                                code_bytes;             // SPIR-V handed to the driver
+    uint64_t                                hits;                   // Lookups answered without creating a module
+    uint64_t                                files_read;
+    double                                  load_ms;                // Reading, validating and creating modules
+};
+
+// Only used from the thread that draws
+void InitShaderCache(VkDevice device);
+
+// Destroys every module, the pipelines using them must be gone
+void FreeShaderCache();
+
+// Loads the file the first time path is seen and returns the same module
+// afterwards. Files with identical content share one module. Exits if the
+// file is missing or not SPIR-V.
+VkShaderModule GetShaderModule(const char* path);
+
+// Same as GetShaderModule for code that is already in memory, such as
+// embedded shaders. key takes the place of the path, code is not kept.
+VkShaderModule GetShaderModuleFromCode(const char* key, const uint32_t* code, size_t size);
+
+// Reads path again even if it was loaded before. Later lookups of path get
+// the new module, the old one stays alive until taken by
+// TakeReplacedShaderModule because pipelines may still be compiling from it.
+VkShaderModule ReloadShaderModule(const char* path);
+
+// Drops the entries of reloaded paths and returns one of their modules that
+// no other entry uses, NULL once there are none left. The caller destroys
+// it after the pipelines built from it.
+VkShaderModule TakeReplacedShaderModule();
+
+void GetShaderCacheStats(struct ShaderCacheStats* stats);
+
+#endif
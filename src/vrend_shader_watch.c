@@ -0,0 +1,223 @@
+#ifdef __linux__
+    #define _DEFAULT_SOURCE
+    #include <poll.h>
+    #include <unistd.h>
+    #include <sys/inotify.h>
+#endif
+#ifdef _WIN32
+    #include <windows.h>
+#endif
+#include <time.h>
+#include <sys/stat.h>
+
+#include "vrend_shader_watch.h"
+
+// How often the watcher checks for changes and for being stopped
+#define SHADER_WATCH_POLL_MS 100
+
+struct WatchedShader {
+    const char*                             source;
+    const char*                             output;
+    time_t                                  modified;               // Only used when polling
+};
+
+static struct WatchedShader             _shaders[MAX_WATCHED_SHADERS] = {0};
+static uint32_t                         _num_shaders = 0;
+static char                             _dir[512] = {0};
+static SDL_Thread*                      _thread = NULL;
+static SDL_atomic_t                     _stop = {0};
+static SDL_mutex*                       _mutex = NULL;
+static uint32_t                         _changed = 0;               // Compiled but not taken yet, under _mutex
+static Uint64                           _saved_time = 0;
+
+int _WatchThread(void* data);
+uint32_t _WaitForChanges(int watch_fd, int timeout_ms, uint32_t* changed, Uint64* first_seen);
+VkBool32 _CompileShader(struct WatchedShader* shader);
+time_t _GetModifiedTime(struct WatchedShader* shader);
+
+uint32_t WatchShader(const char* source, const char* output){
+    if(_num_shaders == MAX_WATCHED_SHADERS){
+        fprintf(stderr, "ERROR: more than %u watched shaders\n", MAX_WATCHED_SHADERS);
+        exit(EXIT_FAILURE);
+    }
+    _shaders[_num_shaders].source = source;
+    _shaders[_num_shaders].output = output;
+    _num_shaders += 1;
+    return _num_shaders - 1;
+}
+
+void StartShaderWatcher(const char* dir){
+    if(_thread != NULL) return;
+
+    snprintf(_dir, sizeof(_dir), "%s", dir);
+    for(uint32_t i = 0; i < _num_shaders; i ++){
+        _shaders[i].modified = _GetModifiedTime(&_shaders[i]);
+    }
+
+    _changed = 0;
+    SDL_AtomicSet(&_stop, 0);
+    _mutex = SDL_CreateMutex();
+    if(_mutex == NULL){
+        fprintf(stderr, "SDL2 ERROR: failed to create shader watcher mutex: %s\n", SDL_GetError());
+        exit(EXIT_FAILURE);
+    }
+    _thread = SDL_CreateThread(_WatchThread, "vrend_shader_watch", NULL);
+    if(_thread == NULL){
+        fprintf(stderr, "SDL2 ERROR: failed to create shader watcher: %s\n", SDL_GetError());
+        exit(EXIT_FAILURE);
+    }
+}
+
+void StopShaderWatcher(){
+    if(_thread == NULL) return;
+
+    SDL_AtomicSet(&_stop, 1);
+    SDL_WaitThread(_thread, NULL);
+    _thread = NULL;
+    SDL_DestroyMutex(_mutex);
+    _mutex = NULL;
+}
+
+VkBool32 TakeShaderChanges(uint32_t* changed, Uint64* saved_time){
+    if(_thread == NULL) return VK_FALSE;
+
+    SDL_LockMutex(_mutex);
+    *changed = _changed;
+    *saved_time = _saved_time;
+    _changed = 0;
+    SDL_UnlockMutex(_mutex);
+    return *changed != 0;
+}
+
+VkBool32 HasShaderChanges(){
+    if(_thread == NULL) return VK_FALSE;
+
+    SDL_LockMutex(_mutex);
+    VkBool32 pending = _changed != 0;
+    SDL_UnlockMutex(_mutex);
+    return pending;
+}
+
+int _WatchThread(void* data){
+    #ifdef __linux__
+        int watch_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if(watch_fd < 0 || inotify_add_watch(watch_fd, _dir, IN_CLOSE_WRITE | IN_MOVED_TO) < 0){
+            fprintf(stderr, "WARNING: failed to watch %s, shader hot reload is off\n", _dir);
+            if(watch_fd >= 0) close(watch_fd);
+            return 0;
+        }
+    #else
+        int watch_fd = -1;
+    #endif
+
+    while(!SDL_AtomicGet(&_stop)){
+        uint32_t changed = 0;
+        Uint64 first_seen = 0;
+        if(_WaitForChanges(watch_fd, SHADER_WATCH_POLL_MS, &changed, &first_seen) == 0) continue;
+
+        // Let the editor finish writing, then pick up anything else it touched
+        SDL_Delay(SHADER_WATCH_SETTLE_MS);
+        _WaitForChanges(watch_fd, 0, &changed, &first_seen);
+
+        uint32_t compiled = 0;
+        for(uint32_t i = 0; i < _num_shaders; i ++){
+            if((changed & (1u << i)) && _CompileShader(&_shaders[i])){
+                compiled |= 1u << i;
+            }
+        }
+        if(compiled == 0) continue;
+
+        SDL_LockMutex(_mutex);
+        if(_changed == 0) _saved_time = first_seen;
+        _changed |= compiled;
+        SDL_UnlockMutex(_mutex);
+    }
+
+    #ifdef __linux__
+        close(watch_fd);
+    #endif
+    return 0;
+}
+
+// Adds the sources that changed to changed and returns only the new ones.
+// first_seen is set by the first change found.
+uint32_t _WaitForChanges(int watch_fd, int timeout_ms, uint32_t* changed, Uint64* first_seen){
+    uint32_t found = 0;
+
+    #ifdef __linux__
+        struct pollfd poll_fd = { watch_fd, POLLIN, 0 };
+        if(poll(&poll_fd, 1, timeout_ms) <= 0) return 0;
+
+        // Events are variable length, so read into a buffer aligned for the struct
+        char buffer[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+        ssize_t length;
+        while((length = read(watch_fd, buffer, sizeof(buffer))) > 0){
+            for(char* p = buffer; p < buffer + length; p += sizeof(struct inotify_event) + ((struct inotify_event*)p)->len){
+                struct inotify_event* event = (struct inotify_event*)p;
+                if(event->len == 0) continue;
+                for(uint32_t i = 0; i < _num_shaders; i ++){
+                    if(strcmp(event->name, _shaders[i].source) == 0){
+                        found |= 1u << i;
+                    }
+                }
+            }
+        }
+    #else
+        SDL_Delay(timeout_ms);
+        for(uint32_t i = 0; i < _num_shaders; i ++){
+            time_t modified = _GetModifiedTime(&_shaders[i]);
+            if(modified != _shaders[i].modified){
+                _shaders[i].modified = modified;
+                found |= 1u << i;
+            }
+        }
+    #endif
+
+    uint32_t new_changes = found & ~*changed;
+    if(found != 0 && *changed == 0){
+        *first_seen = SDL_GetPerformanceCounter();
+    }
+    *changed |= found;
+    return new_changes;
+}
+
+// Compiles next to the output and renames it over, so a failed compile keeps
+// the old SPIR-V and a reader never sees a half written file
+VkBool32 _CompileShader(struct WatchedShader* shader){
+    char source[1024];
+    char output[1024];
+    char tmp_output[1040];
+    char command[4096];
+    snprintf(source, sizeof(source), "%s/%s", _dir, shader->source);
+    snprintf(output, sizeof(output), "%s/%s", _dir, shader->output);
+    snprintf(tmp_output, sizeof(tmp_output), "%s.tmp", output);
+    snprintf(command, sizeof(command), "%s \"%s\" -o \"%s\"", SHADER_COMPILER, source, tmp_output);
+
+    if(system(command) != 0){
+        fprintf(stderr, "WARNING: failed to compile %s, keeping the last good shader\n", source);
+        remove(tmp_output);
+        return VK_FALSE;
+    }
+
+    VkBool32 renamed;
+    #ifdef _WIN32
+        renamed = MoveFileExA(tmp_output, output, MOVEFILE_REPLACE_EXISTING) != 0;
+    #else
+        renamed = rename(tmp_output, output) == 0;
+    #endif
+    if(!renamed){
+        fprintf(stderr, "WARNING: failed to replace %s\n", output);
+        remove(tmp_output);
+        return VK_FALSE;
+    }
+    return VK_TRUE;
+}
+
+// 0 for a missing file
+time_t _GetModifiedTime(struct WatchedShader* shader){
+    char path[1024];
+    snprintf(path, sizeof(path), "%s/%s", _dir, shader->source);
+    struct stat info;
+    if(stat(path, &info) != 0) return 0;
+    return info.st_mtime;
+}
@@ -0,0 +1,37 @@
+#ifndef _VREND_SHADER_WATCH_H_
+#define _VREND_SHADER_WATCH_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <SDL2/SDL.h>
+#include <vulkan/vulkan.h>
+
+#define MAX_WATCHED_SHADERS 8
+
+// Compiler run on changed sources, it has to be on the PATH
+#define SHADER_COMPILER "glslc"
+
+// Changes closer together than this are compiled once, editors often write a file more than once per save
+#define SHADER_WATCH_SETTLE_MS 50
+
+// Not thread safe, call before StartShaderWatcher. source and output are
+// file names inside the watched directory, e.g. "shader.vert" and
+// "vert.spv", and are not copied. Returns the bit used for it in TakeShaderChanges.
+uint32_t WatchShader(const char* source, const char* output);
+
+// Watches dir on a background thread with inotify where available and by
+// polling modification times elsewhere. Changed sources are compiled there,
+// the output is only replaced when the compile succeeded.
+void StartShaderWatcher(const char* dir);
+void StopShaderWatcher();
+
+// Never blocks. Returns VK_TRUE once for every batch of successful compiles,
+// changed has a bit set per WatchShader index and saved_time is when the
+// first change of the batch was seen.
+VkBool32 TakeShaderChanges(uint32_t* changed, Uint64* saved_time);
+
+// Never blocks. VK_TRUE while compiles wait for TakeShaderChanges, without taking them.
+VkBool32 HasShaderChanges();
+
+#endif
@@ -0,0 +1,24 @@
+#include "vrend_shaders.h"
+
+// Each include is the word list glslc writes with -mfmt=c
+static const uint32_t                   _vert_spirv[] =
+    #include "vert.spv.inc"
+;
+static const uint32_t                   _frag_spirv[] =
+    #include "frag.spv.inc"
+;
+
+#define NUM_EMBEDDED_SHADERS 2
+static const struct EmbeddedShader      _shaders[NUM_EMBEDDED_SHADERS] = {
+    { "vert", _vert_spirv, sizeof(_vert_spirv) },
+    { "frag", _frag_spirv, sizeof(_frag_spirv) }
+};
+
+const struct EmbeddedShader* GetEmbeddedShader(const char* name){
+    for(uint32_t i = 0; i < NUM_EMBEDDED_SHADERS; i ++){
+        if(strcmp(_shaders[i].name, name) == 0){
+            return &_shaders[i];
+        }
+    }
+    return NULL;
+}
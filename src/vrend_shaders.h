@@ -0,0 +1,19 @@
+#ifndef _VREND_SHADERS_H_
+#define _VREND_SHADERS_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vulkan/vulkan.h>
+
+// SPIR-V compiled into the binary by the Makefile, see the shader rules there
+struct EmbeddedShader {
+    const char*                             name;                   // File name without .spv, e.g. "vert"
+    const uint32_t*                         code;
+    size_t                                  size;                   // In bytes
+};
+
+// NULL for a name that was not embedded
+const struct EmbeddedShader* GetEmbeddedShader(const char* name);
+
+#endif
@@ -0,0 +1,70 @@
+#include "vrend.h"
+#include "vrend_specialization.h"
+
+void _SetSpecializationWord(struct SpecializationConstants* constants, uint32_t id, uint32_t value);
+
+void SetSpecializationBool(struct SpecializationConstants* constants, uint32_t id, VkBool32 value){
+    _SetSpecializationWord(constants, id, value ? VK_TRUE : VK_FALSE);
+}
+
+void SetSpecializationInt(struct SpecializationConstants* constants, uint32_t id, int32_t value){
+    uint32_t word;
+    memcpy(&word, &value, sizeof(word));
+    _SetSpecializationWord(constants, id, word);
+}
+
+void SetSpecializationUint(struct SpecializationConstants* constants, uint32_t id, uint32_t value){
+    _SetSpecializationWord(constants, id, value);
+}
+
+void SetSpecializationFloat(struct SpecializationConstants* constants, uint32_t id, float value){
+    uint32_t word;
+    memcpy(&word, &value, sizeof(word));
+    _SetSpecializationWord(constants, id, word);
+}
+
+VkBool32 MatchSpecializationConstants(const struct SpecializationConstants* a, const struct SpecializationConstants* b){
+    if(a->count != b->count) return VK_FALSE;
+    for(uint32_t i = 0; i < a->count; i ++){
+        if(a->ids[i] != b->ids[i] || a->values[i] != b->values[i]) return VK_FALSE;
+    }
+    return VK_TRUE;
+}
+
+VkSpecializationInfo* GetSpecializationConstantsInfo(
+            const struct SpecializationConstants* constants,
+            VkSpecializationMapEntry* map_entries,
+            VkSpecializationInfo* info
+){
+    if(constants->count == 0) return NULL;
+
+    for(uint32_t i = 0; i < constants->count; i ++){
+        map_entries[i].constantID = constants->ids[i];
+        map_entries[i].offset = i * sizeof(uint32_t);
+        map_entries[i].size = sizeof(uint32_t);
+    }
+    *info = GetSpecializationInfo(
+        constants->count, map_entries, constants->count * sizeof(uint32_t), (void*)constants->values
+    );
+    return info;
+}
+
+void _SetSpecializationWord(struct SpecializationConstants* constants, uint32_t id, uint32_t value){
+    uint32_t i = 0;
+    while(i < constants->count && constants->ids[i] < id) i ++;
+
+    if(i < constants->count && constants->ids[i] == id){
+        constants->values[i] = value;
+        return;
+    }
+    if(constants->count == MAX_SPECIALIZATION_CONSTANTS){
+        fprintf(stderr, "ERROR: more than %u specialization constants\n", MAX_SPECIALIZATION_CONSTANTS);
+        exit(EXIT_FAILURE);
+    }
+
+    memmove(&constants->ids[i + 1], &constants->ids[i], (constants->count - i) * sizeof(uint32_t));
+    memmove(&constants->values[i + 1], &constants->values[i], (constants->count - i) * sizeof(uint32_t));
+    constants->ids[i] = id;
+    constants->values[i] = value;
+    constants->count += 1;
+}
@@ -0,0 +1,37 @@
+#ifndef _VREND_SPECIALIZATION_H_
+#define _VREND_SPECIALIZATION_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vulkan/vulkan.h>
+
+#define MAX_SPECIALIZATION_CONSTANTS 16
+
+// constant_id to value map for one shader stage, must be zeroed before first
+// use. Every constant is one 32 bit word, which is how SPIR-V stores bool,
+// int, uint and float constants. Kept sorted by id so the same set of values
+// always has the same layout, whatever order they were set in.
+struct SpecializationConstants {
+    uint32_t                                count;
+    uint32_t                                ids[MAX_SPECIALIZATION_CONSTANTS];
+    uint32_t                                values[MAX_SPECIALIZATION_CONSTANTS];
+};
+
+// Setting an id again replaces its value
+void SetSpecializationBool(struct SpecializationConstants* constants, uint32_t id, VkBool32 value);
+void SetSpecializationInt(struct SpecializationConstants* constants, uint32_t id, int32_t value);
+void SetSpecializationUint(struct SpecializationConstants* constants, uint32_t id, uint32_t value);
+void SetSpecializationFloat(struct SpecializationConstants* constants, uint32_t id, float value);
+
+VkBool32 MatchSpecializationConstants(const struct SpecializationConstants* a, const struct SpecializationConstants* b);
+
+// map_entries needs room for MAX_SPECIALIZATION_CONSTANTS. The result points
+// into constants and map_entries, so both must outlive it. NULL without constants.
+VkSpecializationInfo* GetSpecializationConstantsInfo(
+    const struct SpecializationConstants* constants,
+    VkSpecializationMapEntry* map_entries,
+    VkSpecializationInfo* info
+);
+
+#endif
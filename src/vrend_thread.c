@@ -0,0 +1,148 @@
+#include "vrend_thread.h"
+#include "vrend.h"
+#include "vrend_pacer.h"
+
+struct RenderCommand {
+    RenderCommandFunction                   function;
+    uint8_t                                 data[RENDER_COMMAND_DATA_SIZE];
+};
+
+// Single producer single consumer ring. One slot is always left empty so a
+// full ring can be told apart from an empty one without a shared count.
+static struct RenderCommand             _commands[RENDER_QUEUE_SIZE] = {0};
+static SDL_atomic_t                     _write_index = {0};         // Only written by the producer
+static SDL_atomic_t                     _read_index = {0};          // Only written by the render thread
+static SDL_Thread*                      _thread = NULL;
+static SDL_threadID                     _thread_id = 0;
+static SDL_atomic_t                     _stop = {0};
+static SDL_sem*                         _wake = NULL;               // Posted when a command arrives while the thread sleeps
+static SDL_atomic_t                     _sleeping = {0};
+static Uint64                           _last_tick = 0;
+
+int _RenderThread(void* data);
+
+void StartRenderThread(){
+    if(_thread != NULL) return;
+
+    SDL_AtomicSet(&_stop, 0);
+    _wake = SDL_CreateSemaphore(0);
+    if(_wake == NULL){
+        fprintf(stderr, "SDL2 ERROR: failed to create render thread semaphore: %s\n", SDL_GetError());
+        exit(EXIT_FAILURE);
+    }
+    _thread = SDL_CreateThread(_RenderThread, "vrend_render", NULL);
+    if(_thread == NULL){
+        fprintf(stderr, "SDL2 ERROR: failed to create render thread: %s\n", SDL_GetError());
+        exit(EXIT_FAILURE);
+    }
+}
+
+void StopRenderThread(){
+    if(_thread == NULL) return;
+
+    SDL_AtomicSet(&_stop, 1);
+    SDL_SemPost(_wake);
+    SDL_WaitThread(_thread, NULL);
+    _thread = NULL;
+    _thread_id = 0;
+    SDL_DestroySemaphore(_wake);
+    _wake = NULL;
+}
+
+VkBool32 IsRenderThreadRunning(){
+    return _thread != NULL;
+}
+
+VkBool32 IsRenderThreadStopping(){
+    return SDL_AtomicGet(&_stop) != 0;
+}
+
+VkBool32 IsRenderThread(){
+    return _thread_id != 0 && SDL_ThreadID() == _thread_id;
+}
+
+void PushRenderCommand(RenderCommandFunction function, const void* data, uint32_t size){
+    if(size > RENDER_COMMAND_DATA_SIZE){
+        fprintf(stderr, "ERROR: render command data is %u bytes, the limit is %d\n", size, RENDER_COMMAND_DATA_SIZE);
+        exit(EXIT_FAILURE);
+    }
+
+    struct RenderCommand command = {0};
+    command.function = function;
+    if(size > 0) memcpy(command.data, data, size);
+
+    if(_thread == NULL){
+        function(command.data);
+        return;
+    }
+
+    int write_index = SDL_AtomicGet(&_write_index);
+    int next_index = (write_index + 1) & (RENDER_QUEUE_SIZE - 1);
+    while(next_index == SDL_AtomicGet(&_read_index)){
+        SDL_Delay(0);
+    }
+
+    // SDL atomics are full barriers, so the slot is written before it is published
+    _commands[write_index] = command;
+    SDL_AtomicSet(&_write_index, next_index);
+
+    // The render thread checks the ring again after announcing it sleeps, so
+    // either it sees this command or this sees it sleeping
+    if(SDL_AtomicGet(&_sleeping)){
+        SDL_SemPost(_wake);
+    }
+}
+
+void RunRenderCommands(){
+    int read_index = SDL_AtomicGet(&_read_index);
+    int write_index = SDL_AtomicGet(&_write_index);
+    while(read_index != write_index){
+        struct RenderCommand* command = &_commands[read_index];
+        command->function(command->data);
+        read_index = (read_index + 1) & (RENDER_QUEUE_SIZE - 1);
+        SDL_AtomicSet(&_read_index, read_index);
+    }
+}
+
+VkBool32 TickRenderer(){
+    Uint64 now = SDL_GetPerformanceCounter();
+    if(_last_tick != 0){
+        STEP_VREND((double)(now - _last_tick) / SDL_GetPerformanceFrequency());
+    }
+    _last_tick = now;
+
+    if(GET_VREND_STATE() != VREND_STATE_ACTIVE){
+        POLL_VREND_MEMORY();
+        return VK_FALSE;
+    }
+    DRAW_VREND();
+    PaceFrame(GET_VREND_PRESENT_MODE(), GET_VREND_REFRESH_RATE());
+    return VK_TRUE;
+}
+
+int _RenderThread(void* data){
+    _thread_id = SDL_ThreadID();
+
+    while(!IsRenderThreadStopping()){
+        RunRenderCommands();
+        if(TickRenderer()) continue;
+
+        // Idle or hidden: sleep until a command arrives. A running simulation
+        // still has to be stepped while hidden, a paused one only wakes to
+        // check the memory budget.
+        SDL_AtomicSet(&_sleeping, 1);
+        if(SDL_AtomicGet(&_read_index) == SDL_AtomicGet(&_write_index) && !IsRenderThreadStopping()){
+            if(IS_VREND_PAUSED()){
+                SDL_SemWaitTimeout(_wake, VREND_MEMORY_BUDGET_IDLE_MS);
+            } else {
+                SDL_SemWaitTimeout(_wake, HEADLESS_STEP_MS);
+            }
+        }
+        SDL_AtomicSet(&_sleeping, 0);
+    }
+
+    // Commands pushed before the stop request still run
+    RunRenderCommands();
+
+    return 0;
+}
@@ -0,0 +1,45 @@
+#ifndef _VREND_THREAD_H_
+#define _VREND_THREAD_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <SDL2/SDL.h>
+#include <vulkan/vulkan.h>
+
+// Must be a power of two
+#define RENDER_QUEUE_SIZE 256
+#define RENDER_COMMAND_DATA_SIZE 32
+
+// Simulation step length while no frames are drawn
+#define HEADLESS_STEP_MS 16
+
+// Runs on the render thread. data points at a copy of what was pushed and is
+// only valid for the duration of the call.
+typedef void (*RenderCommandFunction)(void* data);
+
+// The render thread drains the command queue, draws and paces frames until stopped.
+// Everything that touches the renderer after this must go through PushRenderCommand.
+void StartRenderThread();
+
+// Lets the current frame finish, runs the remaining commands and joins the thread
+void StopRenderThread();
+
+VkBool32 IsRenderThreadRunning();
+VkBool32 IsRenderThreadStopping();
+VkBool32 IsRenderThread();
+
+// Single producer: only the thread that started the render thread may push.
+// Runs the command inline when the render thread is not running. Only waits
+// when the queue is full, i.e. the render thread is RENDER_QUEUE_SIZE commands behind.
+void PushRenderCommand(RenderCommandFunction function, const void* data, uint32_t size);
+
+// Runs all queued commands on the calling thread
+void RunRenderCommands();
+
+// Steps the simulation by the time since the last tick, then draws and paces
+// a frame if one is wanted. Returns VK_FALSE when no frame was drawn, the
+// caller should then sleep until input arrives or HEADLESS_STEP_MS passed.
+VkBool32 TickRenderer();
+
+#endif
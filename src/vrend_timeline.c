@@ -0,0 +1,111 @@
+#include "vrend.h"
+#include "vrend_timeline.h"
+#include "vrend_host_alloc.h"
+
+void InitQueueTimeline(VkDevice device, VkQueue queue, uint32_t family_index, struct QueueTimeline* timeline){
+    timeline->queue = queue;
+    timeline->family_index = family_index;
+    timeline->next_value = 1;
+    timeline->completed_value = 0;
+
+    VkSemaphoreTypeCreateInfo semaphore_type_ci = GetSemaphoreTypeCI(VK_SEMAPHORE_TYPE_TIMELINE, 0);
+    VkSemaphoreCreateInfo semaphore_ci = GetSemaphoreCI(0);
+    semaphore_ci.pNext = &semaphore_type_ci;
+    VK_CHECK(vkCreateSemaphore, device, &semaphore_ci, GetHostAllocator(), &timeline->semaphore);
+}
+
+void FreeQueueTimeline(VkDevice device, struct QueueTimeline* timeline){
+    vkDestroySemaphore(device, timeline->semaphore, GetHostAllocator());
+    *timeline = (struct QueueTimeline){0};
+}
+
+uint64_t SubmitQueueTimeline(
+            struct QueueTimeline* timeline,
+            uint32_t command_buffer_count,
+            VkCommandBuffer* command_buffers,
+            uint32_t wait_count,
+            struct TimelineWait* waits,
+            VkSemaphore binary_wait,
+            VkPipelineStageFlags binary_wait_stage,
+            VkSemaphore binary_signal
+){
+    if(wait_count > MAX_TIMELINE_WAITS){
+        fprintf(stderr, "ERROR: too many timeline waits in one submission\n");
+        exit(EXIT_FAILURE);
+    }
+
+    // Values for binary semaphores are ignored but must have a slot
+    VkSemaphore wait_semaphores[MAX_TIMELINE_WAITS + 1];
+    uint64_t wait_values[MAX_TIMELINE_WAITS + 1];
+    VkPipelineStageFlags wait_stages[MAX_TIMELINE_WAITS + 1];
+    uint32_t num_waits = 0;
+    for(uint32_t i = 0; i < wait_count; i ++){
+        wait_semaphores[num_waits] = waits[i].timeline->semaphore;
+        wait_values[num_waits] = waits[i].value;
+        wait_stages[num_waits] = waits[i].stage;
+        num_waits += 1;
+    }
+    if(binary_wait != NULL){
+        wait_semaphores[num_waits] = binary_wait;
+        wait_values[num_waits] = 0;
+        wait_stages[num_waits] = binary_wait_stage;
+        num_waits += 1;
+    }
+
+    uint64_t value = timeline->next_value;
+    VkSemaphore signal_semaphores[2] = { timeline->semaphore, binary_signal };
+    uint64_t signal_values[2] = { value, 0 };
+    uint32_t num_signals = binary_signal != NULL ? 2 : 1;
+
+    VkTimelineSemaphoreSubmitInfo timeline_si = GetTimelineSemaphoreSI(
+        num_waits, wait_values, num_signals, signal_values
+    );
+
+    VkSubmitInfo submit = {0};
+    submit.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submit.pNext = &timeline_si;
+    submit.waitSemaphoreCount = num_waits;
+    submit.pWaitSemaphores = wait_semaphores;
+    submit.pWaitDstStageMask = wait_stages;
+    submit.signalSemaphoreCount = num_signals;
+    submit.pSignalSemaphores = signal_semaphores;
+    submit.commandBufferCount = command_buffer_count;
+    submit.pCommandBuffers = command_buffers;
+
+    VK_CHECK_S(vkQueueSubmit, timeline->queue, 1, &submit, NULL);
+
+    timeline->next_value += 1;
+    return value;
+}
+
+void WaitQueueTimeline(VkDevice device, struct QueueTimeline* timeline, uint64_t value){
+    if(value <= timeline->completed_value){
+        return;
+    }
+
+    VkSemaphoreWaitInfo wait_info = {0};
+    wait_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+    wait_info.pNext = NULL;
+    wait_info.flags = 0;
+    wait_info.semaphoreCount = 1;
+    wait_info.pSemaphores = &timeline->semaphore;
+    wait_info.pValues = &value;
+    VK_CHECK_S(vkWaitSemaphores, device, &wait_info, UINT64_MAX);
+
+    timeline->completed_value = value;
+}
+
+VkBool32 IsQueueTimelineComplete(VkDevice device, struct QueueTimeline* timeline, uint64_t value){
+    if(value <= timeline->completed_value){
+        return VK_TRUE;
+    }
+
+    uint64_t current = 0;
+    VK_CHECK_S(vkGetSemaphoreCounterValue, device, timeline->semaphore, &current);
+    timeline->completed_value = current;
+    return value <= current;
+}
+
+uint64_t GetQueueTimelineLastSubmitted(struct QueueTimeline* timeline){
+    return timeline->next_value - 1;
+}
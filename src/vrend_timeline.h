@@ -0,0 +1,50 @@
+#ifndef _VREND_TIMELINE_H_
+#define _VREND_TIMELINE_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <vulkan/vulkan.h>
+
+#define MAX_TIMELINE_WAITS 4
+
+// One timeline semaphore per queue. Every submission signals the next value,
+// so a value identifies exactly one submission on that queue.
+struct QueueTimeline {
+    VkQueue                                 queue;
+    uint32_t                                family_index;
+    VkSemaphore                             semaphore;
+    uint64_t                                next_value;             // Value signaled by the next submission
+    uint64_t                                completed_value;        // Last value known to be reached
+};
+
+// Makes a submission wait for a value on another queue's timeline
+struct TimelineWait {
+    struct QueueTimeline*                   timeline;
+    uint64_t                                value;
+    VkPipelineStageFlags                    stage;
+};
+
+void InitQueueTimeline(VkDevice device, VkQueue queue, uint32_t family_index, struct QueueTimeline* timeline);
+void FreeQueueTimeline(VkDevice device, struct QueueTimeline* timeline);
+
+// Returns the timeline value signaled when the submission completes.
+// The binary semaphores are optional and exist for the swap chain, which
+// cannot wait on or signal timeline semaphores.
+uint64_t SubmitQueueTimeline(
+    struct QueueTimeline* timeline,
+    uint32_t command_buffer_count,
+    VkCommandBuffer* command_buffers,
+    uint32_t wait_count,
+    struct TimelineWait* waits,
+    VkSemaphore binary_wait,
+    VkPipelineStageFlags binary_wait_stage,
+    VkSemaphore binary_signal
+);
+
+void WaitQueueTimeline(VkDevice device, struct QueueTimeline* timeline, uint64_t value);
+VkBool32 IsQueueTimelineComplete(VkDevice device, struct QueueTimeline* timeline, uint64_t value);
+
+// Last value submitted to the queue, 0 if nothing was submitted yet
+uint64_t GetQueueTimelineLastSubmitted(struct QueueTimeline* timeline);
+
+#endif
@@ -0,0 +1,586 @@
+#include "vrend.h"
+#include "vrend_transfer.h"
+#include "vrend_present.h"
+#include "vrend_host_alloc.h"
+
+// Staging offsets stay aligned for any texel size that divides 16, which
+// bufferOffset must be a multiple of. Other texel sizes are rejected.
+#define TRANSFER_STAGING_ALIGNMENT 16
+
+// Buffer uploads are not split into pieces smaller than this when staging runs low
+#define MIN_TRANSFER_CHUNK (64 * 1024)
+
+#define INITIAL_TRANSFER_REQUESTS 64
+
+enum TransferBatchState {
+    TRANSFER_BATCH_FREE,
+    TRANSFER_BATCH_RECORDING,
+    TRANSFER_BATCH_SUBMITTED,
+    TRANSFER_BATCH_ACQUIRING                                        // Acquires handed to the graphics queue
+};
+
+struct TransferRequest {
+    uint64_t                                ticket;
+    const uint8_t*                          data;
+    VkDeviceSize                            size;
+    VkDeviceSize                            copied;                 // Bytes recorded so far
+    VkBuffer                                buffer;                 // NULL for images
+    VkDeviceSize                            offset;
+    VkImage                                 image;
+    VkExtent2D                              extent;
+    VkDeviceSize                            row_size;
+    VkDeviceSize                            chunk_size;             // Images are split on multiples of this
+    VkImageAspectFlags                      aspect;
+    VkImageLayout                           final_layout;
+};
+
+struct TransferBatch {
+    enum TransferBatchState                 state;
+    VkCommandBuffer                         command_buffer;         // Transfer family
+    VkCommandBuffer                         acquire_buffer;         // Graphics family, only with a dedicated queue
+    uint32_t                                num_acquires;           // Barriers recorded into acquire_buffer
+    uint64_t                                value;                  // Transfer timeline value of the copies
+    uint64_t                                acquire_value;          // Graphics timeline value of the submission with the acquires
+    VkDeviceSize                            staging_bytes;          // Staging in use, including what was skipped at the wrap
+    VkDeviceSize                            bytes;
+    uint64_t                                last_ticket;            // Last upload finished by the batch, 0 if none
+};
+
+static VkDevice                         _device = NULL;
+static struct QueueTimeline*            _transfer = NULL;
+static struct QueueTimeline*            _graphics = NULL;
+static VkBool32                         _dedicated = VK_FALSE;
+static VkExtent3D                       _image_granularity = {0};   // Of the transfer family, 0x0x0 for whole images only
+static VkCommandPool                    _command_pool = NULL;
+static VkCommandPool                    _acquire_pool = NULL;
+static VkBuffer                         _staging_buffer = NULL;     // Created by the first upload after a trim
+static struct GpuAllocation             _staging_allocation = {0};
+static VkDeviceSize                     _staging_head = 0;          // Next byte written
+static VkDeviceSize                     _staging_used = 0;          // Bytes behind the head still read by batches
+static struct TransferBatch             _batches[MAX_TRANSFER_BATCHES] = {0};
+static uint32_t                         _first_batch = 0;           // Oldest batch that is not free
+static uint32_t                         _num_batches = 0;
+static struct TransferRequest*          _requests = NULL;
+static uint32_t                         _first_request = 0;         // Oldest unfinished request
+static uint32_t                         _num_requests = 0;
+static uint32_t                         _max_requests = 0;
+static uint64_t                         _next_ticket = 1;
+static uint64_t                         _ready_ticket = 0;          // Every ticket up to this one is usable by graphics
+static struct TransferStats             _stats = {0};
+
+uint64_t _QueueRequest(struct TransferRequest* request);
+void _CreateStaging();
+VkBool32 _AllocateStaging(VkDeviceSize minimum, VkDeviceSize granule, VkDeviceSize* size, VkDeviceSize* offset, VkDeviceSize* consumed);
+struct TransferBatch* _OpenBatch();
+void _SubmitBatch(struct TransferBatch* batch);
+void _CollectBatches(VkBool32 wait);
+void _SubmitAcquires();
+void _RecordChunk(struct TransferBatch* batch, struct TransferRequest* request, VkDeviceSize size, VkDeviceSize staging_offset);
+void _RecordOwnership(struct TransferBatch* batch, struct TransferRequest* request);
+VkImageMemoryBarrier _GetImageBarrier(struct TransferRequest* request, VkImageLayout old_layout, VkImageLayout new_layout);
+
+void InitTransferManager(VkDevice device, struct QueueTimeline* transfer, struct QueueTimeline* graphics, VkExtent3D image_granularity){
+    _device = device;
+    _transfer = transfer;
+    _graphics = graphics;
+    _dedicated = transfer->family_index != graphics->family_index;
+    _image_granularity = image_granularity;
+
+    VkCommandPoolCreateInfo command_pool_ci = GetCommandPoolCI(
+        transfer->family_index, VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT
+    );
+    VK_CHECK(vkCreateCommandPool, _device, &command_pool_ci, GetHostAllocator(), &_command_pool);
+    VkCommandBufferAllocateInfo command_buffer_ai = GetCommandBufferAI(_command_pool, 1, VK_COMMAND_BUFFER_LEVEL_PRIMARY);
+    for(uint32_t i = 0; i < MAX_TRANSFER_BATCHES; i ++){
+        VK_CHECK_S(vkAllocateCommandBuffers, _device, &command_buffer_ai, &_batches[i].command_buffer);
+    }
+
+    // Acquires are recorded together with the releases and submitted later by a frame
+    if(_dedicated){
+        command_pool_ci = GetCommandPoolCI(graphics->family_index, VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT);
+        VK_CHECK(vkCreateCommandPool, _device, &command_pool_ci, GetHostAllocator(), &_acquire_pool);
+        command_buffer_ai = GetCommandBufferAI(_acquire_pool, 1, VK_COMMAND_BUFFER_LEVEL_PRIMARY);
+        for(uint32_t i = 0; i < MAX_TRANSFER_BATCHES; i ++){
+            VK_CHECK_S(vkAllocateCommandBuffers, _device, &command_buffer_ai, &_batches[i].acquire_buffer);
+        }
+    }
+
+    _CreateStaging();
+
+    _max_requests = INITIAL_TRANSFER_REQUESTS;
+    _requests = malloc(sizeof(struct TransferRequest) * _max_requests);
+    _first_request = 0;
+    _num_requests = 0;
+    _next_ticket = 1;
+    _ready_ticket = 0;
+
+    memset(&_stats, 0, sizeof(struct TransferStats));
+    _stats.dedicated = _dedicated;
+}
+
+void FreeTransferManager(){
+    WaitQueueTimeline(_device, _transfer, GetQueueTimelineLastSubmitted(_transfer));
+    WaitQueueTimeline(_device, _graphics, GetQueueTimelineLastSubmitted(_graphics));
+    if(_num_requests > _first_request){
+        fprintf(stderr, "WARNING: %u uploads were never finished\n", _num_requests - _first_request);
+    }
+
+    vkDestroyCommandPool(_device, _command_pool, GetHostAllocator());
+    if(_acquire_pool != NULL){
+        vkDestroyCommandPool(_device, _acquire_pool, GetHostAllocator());
+    }
+    vkDestroyBuffer(_device, _staging_buffer, GetHostAllocator());
+    GpuFree(&_staging_allocation);
+    free(_requests);
+
+    _command_pool = NULL;
+    _acquire_pool = NULL;
+    _staging_buffer = NULL;
+    _requests = NULL;
+    memset(_batches, 0, sizeof(_batches));
+    _first_batch = 0;
+    _num_batches = 0;
+}
+
+uint64_t UploadBuffer(VkBuffer buffer, VkDeviceSize offset, const void* data, VkDeviceSize size){
+    struct TransferRequest request = {0};
+    request.data = data;
+    request.size = size;
+    request.buffer = buffer;
+    request.offset = offset;
+    return _QueueRequest(&request);
+}
+
+uint64_t UploadImage(
+            VkImage image,
+            VkExtent2D extent,
+            uint32_t texel_size,
+            VkImageAspectFlags aspect,
+            VkImageLayout final_layout,
+            const void* data
+){
+    if(texel_size == 0 || TRANSFER_STAGING_ALIGNMENT % texel_size != 0){
+        fprintf(stderr, "ERROR: image upload with %u byte texels, the size must divide %u\n", texel_size, TRANSFER_STAGING_ALIGNMENT);
+        exit(EXIT_FAILURE);
+    }
+
+    struct TransferRequest request = {0};
+    request.data = data;
+    request.image = image;
+    request.extent = extent;
+    request.row_size = (VkDeviceSize)extent.width * texel_size;
+    request.size = request.row_size * extent.height;
+
+    // Chunks start on rows that are multiples of the granularity height,
+    // only the last one may be shorter since it ends at the image edge
+    if(_image_granularity.height == 0){
+        request.chunk_size = request.size;
+    } else {
+        request.chunk_size = request.row_size * _image_granularity.height;
+    }
+    if(request.chunk_size > TRANSFER_STAGING_SIZE){
+        fprintf(stderr, "ERROR: %ux%u image upload cannot be split to fit in staging\n", extent.width, extent.height);
+        exit(EXIT_FAILURE);
+    }
+
+    request.aspect = aspect;
+    request.final_layout = final_layout;
+    return _QueueRequest(&request);
+}
+
+void PumpTransfers(){
+    _CollectBatches(VK_FALSE);
+    if(_first_request == _num_requests) return;
+
+    // Every batch is still in flight, waiting here would stall the frame
+    if(_num_batches == MAX_TRANSFER_BATCHES){
+        _stats.deferred_frames += 1;
+        return;
+    }
+
+    if(_staging_buffer == NULL){
+        _CreateStaging();
+    }
+
+    struct TransferBatch* batch = NULL;
+    VkDeviceSize budget = TRANSFER_BYTES_PER_FRAME;
+    while(_first_request < _num_requests && budget > 0){
+        struct TransferRequest* request = &_requests[_first_request];
+        VkDeviceSize remaining = request->size - request->copied;
+
+        // Images are copied in whole chunks, at least one even past the budget
+        VkDeviceSize granule = request->image != NULL ? request->chunk_size : 1;
+        if(granule > remaining) granule = remaining;
+        VkDeviceSize size = (remaining < budget ? remaining : budget) / granule * granule;
+        if(size == 0) size = granule;
+        VkDeviceSize minimum = size < MIN_TRANSFER_CHUNK ? size : MIN_TRANSFER_CHUNK;
+        if(minimum < granule) minimum = granule;
+
+        // Staging is full of batches still in flight, the rest goes next frame
+        VkDeviceSize staging_offset = 0;
+        VkDeviceSize consumed = 0;
+        if(!_AllocateStaging(minimum, granule, &size, &staging_offset, &consumed)){
+            if(batch == NULL) _stats.deferred_frames += 1;
+            break;
+        }
+        if(batch == NULL){
+            batch = _OpenBatch();
+        }
+        batch->staging_bytes += consumed;
+
+        memcpy(_staging_allocation.mapped + staging_offset, request->data + request->copied, size);
+        _RecordChunk(batch, request, size, staging_offset);
+        request->copied += size;
+        batch->bytes += size;
+        _stats.pending_bytes -= size;
+        budget = size < budget ? budget - size : 0;
+
+        if(request->copied == request->size){
+            _RecordOwnership(batch, request);
+            batch->last_ticket = request->ticket;
+            _first_request += 1;
+        }
+    }
+
+    if(_first_request == _num_requests){
+        _first_request = 0;
+        _num_requests = 0;
+    }
+    if(batch != NULL){
+        _SubmitBatch(batch);
+    }
+}
+
+uint32_t TakeTransferAcquires(VkCommandBuffer* command_buffers, struct TimelineWait* wait){
+    memset(wait, 0, sizeof(struct TimelineWait));
+    uint32_t count = 0;
+    for(uint32_t i = 0; i < _num_batches; i ++){
+        struct TransferBatch* batch = &_batches[(_first_batch + i) % MAX_TRANSFER_BATCHES];
+        if(batch->state == TRANSFER_BATCH_ACQUIRING) continue;
+        if(batch->state != TRANSFER_BATCH_SUBMITTED) break;
+
+        // Only finished copies are acquired, so the frame never waits on the transfer queue
+        if(!IsQueueTimelineComplete(_device, _transfer, batch->value)) break;
+        if(batch->num_acquires == 0) continue;
+
+        command_buffers[count] = batch->acquire_buffer;
+        count += 1;
+        batch->state = TRANSFER_BATCH_ACQUIRING;
+        batch->acquire_value = _graphics->next_value;
+        if(batch->last_ticket > _ready_ticket) _ready_ticket = batch->last_ticket;
+
+        wait->timeline = _transfer;
+        wait->value = batch->value;
+        wait->stage = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+    }
+    return count;
+}
+
+VkBool32 IsTransferReady(uint64_t ticket){
+    return ticket <= _ready_ticket;
+}
+
+void WaitTransfer(uint64_t ticket){
+    while(!IsTransferReady(ticket)){
+        PumpTransfers();
+        _SubmitAcquires();
+        if(IsTransferReady(ticket)) return;
+        _CollectBatches(VK_TRUE);
+    }
+}
+
+VkDeviceSize TrimTransferStaging(){
+
+    // Staging comes back once the copies reading it are done, so nothing can still use it
+    if(_staging_buffer == NULL || _staging_used > 0 || _first_request < _num_requests){
+        return 0;
+    }
+    vkDestroyBuffer(_device, _staging_buffer, GetHostAllocator());
+    GpuFree(&_staging_allocation);
+    _staging_buffer = NULL;
+    _stats.staging_trims += 1;
+    return TRANSFER_STAGING_SIZE;
+}
+
+void GetTransferStats(struct TransferStats* stats){
+    *stats = _stats;
+    stats->unready_uploads = _next_ticket - 1 - _ready_ticket;
+}
+
+uint64_t _QueueRequest(struct TransferRequest* request){
+    if(request->size == 0){
+        fprintf(stderr, "ERROR: empty upload\n");
+        exit(EXIT_FAILURE);
+    }
+
+    if(_num_requests == _max_requests){
+
+        // Finished requests at the front make room before the array grows
+        if(_first_request > 0){
+            memmove(_requests, _requests + _first_request, sizeof(struct TransferRequest) * (_num_requests - _first_request));
+            _num_requests -= _first_request;
+            _first_request = 0;
+        }
+        if(_num_requests == _max_requests){
+            _max_requests *= 2;
+            _requests = realloc(_requests, sizeof(struct TransferRequest) * _max_requests);
+        }
+    }
+
+    request->ticket = _next_ticket;
+    _next_ticket += 1;
+    _requests[_num_requests] = *request;
+    _num_requests += 1;
+
+    _stats.uploads += 1;
+    _stats.pending_bytes += request->size;
+    return request->ticket;
+}
+
+// Every implementation has a host visible and coherent type, so nothing is ever flushed
+void _CreateStaging(){
+    VkBufferCreateInfo buffer_ci = GetBufferCI(TRANSFER_STAGING_SIZE, VK_BUFFER_USAGE_TRANSFER_SRC_BIT);
+    VK_CHECK(
+        CreateGpuBuffer, &buffer_ci,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, 0,
+        &_staging_buffer, &_staging_allocation
+    );
+    _staging_head = 0;
+    _staging_used = 0;
+}
+
+// size is the wanted size on input and a multiple of granule no smaller
+// than minimum on success. consumed includes the end of the ring when it
+// was too small and skipped.
+VkBool32 _AllocateStaging(VkDeviceSize minimum, VkDeviceSize granule, VkDeviceSize* size, VkDeviceSize* offset, VkDeviceSize* consumed){
+    *consumed = 0;
+    if(_staging_used == 0){
+        _staging_head = 0;
+    }
+
+    VkDeviceSize tail = (_staging_head + TRANSFER_STAGING_SIZE - _staging_used) % TRANSFER_STAGING_SIZE;
+    VkDeviceSize available = 0;
+    if(_staging_used == TRANSFER_STAGING_SIZE){
+        available = 0;
+    } else if(tail > _staging_head){
+        available = tail - _staging_head;
+    } else {
+        available = TRANSFER_STAGING_SIZE - _staging_head;
+        if(available < minimum && tail >= minimum){
+            *consumed = available;
+            _staging_used += available;
+            _staging_head = 0;
+            available = tail;
+        }
+    }
+    if(available < minimum){
+        return VK_FALSE;
+    }
+
+    if(*size > available) *size = available;
+    *size = *size / granule * granule;
+    VkDeviceSize aligned = (*size + TRANSFER_STAGING_ALIGNMENT - 1) / TRANSFER_STAGING_ALIGNMENT * TRANSFER_STAGING_ALIGNMENT;
+
+    *offset = _staging_head;
+    *consumed += aligned;
+    _staging_head = (_staging_head + aligned) % TRANSFER_STAGING_SIZE;
+    _staging_used += aligned;
+    return VK_TRUE;
+}
+
+struct TransferBatch* _OpenBatch(){
+    struct TransferBatch* batch = &_batches[(_first_batch + _num_batches) % MAX_TRANSFER_BATCHES];
+    _num_batches += 1;
+    batch->state = TRANSFER_BATCH_RECORDING;
+    batch->num_acquires = 0;
+    batch->value = 0;
+    batch->acquire_value = 0;
+    batch->staging_bytes = 0;
+    batch->bytes = 0;
+    batch->last_ticket = 0;
+
+    VkCommandBufferBeginInfo begin_info = GetCommandBufferBI(NULL, VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
+    VK_CHECK_S(vkBeginCommandBuffer, batch->command_buffer, &begin_info);
+    if(_dedicated){
+        VK_CHECK_S(vkBeginCommandBuffer, batch->acquire_buffer, &begin_info);
+    }
+    return batch;
+}
+
+void _SubmitBatch(struct TransferBatch* batch){
+    VK_CHECK_S(vkEndCommandBuffer, batch->command_buffer);
+    if(_dedicated){
+        VK_CHECK_S(vkEndCommandBuffer, batch->acquire_buffer);
+    }
+
+    // Without a dedicated queue the copies go to the graphics queue, which the present thread may share
+    if(!_dedicated) LockPresentQueue();
+    batch->value = SubmitQueueTimeline(_transfer, 1, &batch->command_buffer, 0, NULL, NULL, 0, NULL);
+    if(!_dedicated) UnlockPresentQueue();
+    batch->state = TRANSFER_BATCH_SUBMITTED;
+
+    // On the graphics queue the barriers already order later frames after the copies
+    if(!_dedicated && batch->last_ticket > _ready_ticket){
+        _ready_ticket = batch->last_ticket;
+    }
+
+    _stats.batches += 1;
+    _stats.bytes += batch->bytes;
+    if(batch->bytes > _stats.max_batch_bytes) _stats.max_batch_bytes = batch->bytes;
+}
+
+// Frees batches in submission order. With wait, frees at least the oldest.
+void _CollectBatches(VkBool32 wait){
+
+    // Staging comes back as soon as the copies are done, even while earlier
+    // batches still wait for a frame to acquire them
+    for(uint32_t i = 0; i < _num_batches; i ++){
+        struct TransferBatch* batch = &_batches[(_first_batch + i) % MAX_TRANSFER_BATCHES];
+        if(batch->staging_bytes == 0) continue;
+        if(!IsQueueTimelineComplete(_device, _transfer, batch->value)) break;
+        _staging_used -= batch->staging_bytes;
+        batch->staging_bytes = 0;
+    }
+
+    while(_num_batches > 0){
+        struct TransferBatch* batch = &_batches[_first_batch];
+        if(wait){
+            WaitQueueTimeline(_device, _transfer, batch->value);
+            if(batch->state == TRANSFER_BATCH_SUBMITTED && batch->num_acquires > 0){
+                _SubmitAcquires();
+            }
+            if(batch->state == TRANSFER_BATCH_ACQUIRING){
+                WaitQueueTimeline(_device, _graphics, batch->acquire_value);
+            }
+        }
+
+        if(!IsQueueTimelineComplete(_device, _transfer, batch->value)) return;
+        if(batch->num_acquires > 0){
+            if(batch->state != TRANSFER_BATCH_ACQUIRING) return;
+            if(!IsQueueTimelineComplete(_device, _graphics, batch->acquire_value)) return;
+        }
+
+        _staging_used -= batch->staging_bytes;
+        batch->staging_bytes = 0;
+        batch->state = TRANSFER_BATCH_FREE;
+        _first_batch = (_first_batch + 1) % MAX_TRANSFER_BATCHES;
+        _num_batches -= 1;
+        wait = VK_FALSE;
+    }
+}
+
+// For when no frame is coming to take the acquires
+void _SubmitAcquires(){
+    VkCommandBuffer command_buffers[MAX_TRANSFER_BATCHES];
+    struct TimelineWait wait = {0};
+    uint32_t count = TakeTransferAcquires(command_buffers, &wait);
+    if(count == 0) return;
+
+    LockPresentQueue();
+    SubmitQueueTimeline(_graphics, count, command_buffers, 1, &wait, NULL, 0, NULL);
+    UnlockPresentQueue();
+}
+
+void _RecordChunk(struct TransferBatch* batch, struct TransferRequest* request, VkDeviceSize size, VkDeviceSize staging_offset){
+    if(request->buffer != NULL){
+        VkBufferCopy region = {0};
+        region.srcOffset = staging_offset;
+        region.dstOffset = request->offset + request->copied;
+        region.size = size;
+        vkCmdCopyBuffer(batch->command_buffer, _staging_buffer, request->buffer, 1, &region);
+        return;
+    }
+
+    // Previous contents are discarded on the first copy
+    if(request->copied == 0){
+        VkImageMemoryBarrier barrier = _GetImageBarrier(
+            request, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL
+        );
+        barrier.srcAccessMask = 0;
+        barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        vkCmdPipelineBarrier(
+            batch->command_buffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+            0, 0, NULL, 0, NULL, 1, &barrier
+        );
+    }
+
+    VkBufferImageCopy region = {0};
+    region.bufferOffset = staging_offset;
+    region.bufferRowLength = 0;
+    region.bufferImageHeight = 0;
+    region.imageSubresource.aspectMask = request->aspect;
+    region.imageSubresource.mipLevel = 0;
+    region.imageSubresource.baseArrayLayer = 0;
+    region.imageSubresource.layerCount = 1;
+    region.imageOffset = (VkOffset3D){ 0, (int32_t)(request->copied / request->row_size), 0 };
+    region.imageExtent = (VkExtent3D){ request->extent.width, (uint32_t)(size / request->row_size), 1 };
+    vkCmdCopyBufferToImage(
+        batch->command_buffer, _staging_buffer, request->image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region
+    );
+}
+
+// Makes a finished upload visible to graphics. With a dedicated queue this
+// is a release here and the matching acquire in the batch's acquire buffer.
+void _RecordOwnership(struct TransferBatch* batch, struct TransferRequest* request){
+    VkPipelineStageFlags dst_stage = _dedicated ? VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT : VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+    VkAccessFlags dst_access = _dedicated ? 0 : VK_ACCESS_MEMORY_READ_BIT;
+    uint32_t src_family = _dedicated ? _transfer->family_index : VK_QUEUE_FAMILY_IGNORED;
+    uint32_t dst_family = _dedicated ? _graphics->family_index : VK_QUEUE_FAMILY_IGNORED;
+
+    VkBufferMemoryBarrier buffer_barrier = {0};
+    VkImageMemoryBarrier image_barrier = {0};
+    uint32_t num_buffer_barriers = 0;
+    uint32_t num_image_barriers = 0;
+    if(request->buffer != NULL){
+        buffer_barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+        buffer_barrier.pNext = NULL;
+        buffer_barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        buffer_barrier.dstAccessMask = dst_access;
+        buffer_barrier.srcQueueFamilyIndex = src_family;
+        buffer_barrier.dstQueueFamilyIndex = dst_family;
+        buffer_barrier.buffer = request->buffer;
+        buffer_barrier.offset = request->offset;
+        buffer_barrier.size = request->size;
+        num_buffer_barriers = 1;
+    } else {
+        image_barrier = _GetImageBarrier(request, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, request->final_layout);
+        image_barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        image_barrier.dstAccessMask = dst_access;
+        image_barrier.srcQueueFamilyIndex = src_family;
+        image_barrier.dstQueueFamilyIndex = dst_family;
+        num_image_barriers = 1;
+    }
+    vkCmdPipelineBarrier(
+        batch->command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, dst_stage,
+        0, 0, NULL, num_buffer_barriers, &buffer_barrier, num_image_barriers, &image_barrier
+    );
+    if(!_dedicated) return;
+
+    // The acquire repeats the release, including the layout change
+    buffer_barrier.srcAccessMask = 0;
+    buffer_barrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT;
+    image_barrier.srcAccessMask = 0;
+    image_barrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT;
+    vkCmdPipelineBarrier(
+        batch->acquire_buffer, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+        0, 0, NULL, num_buffer_barriers, &buffer_barrier, num_image_barriers, &image_barrier
+    );
+    batch->num_acquires += 1;
+}
+
+VkImageMemoryBarrier _GetImageBarrier(struct TransferRequest* request, VkImageLayout old_layout, VkImageLayout new_layout){
+    VkImageMemoryBarrier barrier = {0};
+    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.pNext = NULL;
+    barrier.oldLayout = old_layout;
+    barrier.newLayout = new_layout;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.image = request->image;
+    barrier.subresourceRange.aspectMask = request->aspect;
+    barrier.subresourceRange.baseMipLevel = 0;
+    barrier.subresourceRange.levelCount = 1;
+    barrier.subresourceRange.baseArrayLayer = 0;
+    barrier.subresourceRange.layerCount = 1;
+    return barrier;
+}
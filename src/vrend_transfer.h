@@ -0,0 +1,84 @@
+#ifndef _VREND_TRANSFER_H_
+#define _VREND_TRANSFER_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vulkan/vulkan.h>
+
+#include "vrend_timeline.h"
+#include "vrend_memory.h"
+
+// Uploads are copied into the staging ring and recorded into batches of
+// at most TRANSFER_BYTES_PER_FRAME, so an upload of any size is spread over
+// frames instead of stalling one
+#define TRANSFER_STAGING_SIZE (64 * 1024 * 1024)
+#define TRANSFER_BYTES_PER_FRAME (16 * 1024 * 1024)
+#define MAX_TRANSFER_BATCHES 4
+
+struct TransferStats {
+    VkBool32                                dedicated;              // Copies run on a transfer only queue family
+    uint64_t                                uploads;
+    uint64_t                                bytes;
+    uint64_t                                batches;
+    uint64_t                                deferred_frames;        // Pumps that copied nothing, staging or every batch was in use
+    VkDeviceSize                            max_batch_bytes;
+    VkDeviceSize                            pending_bytes;          // Queued but not yet copied to staging
+    uint64_t                                unready_uploads;        // Not yet usable by graphics, including copies waiting for an acquire
+    uint64_t                                staging_trims;          // Staging ring released by TrimTransferStaging
+};
+
+// transfer and graphics are the same timeline when there is no transfer
+// only family, the copies then run on the graphics queue and need no
+// ownership transfer. image_granularity is minImageTransferGranularity of
+// the transfer family, image uploads are split on multiples of its height
+// and not at all when it is 0x0x0. Not thread safe, only used from the
+// thread that draws.
+void InitTransferManager(VkDevice device, struct QueueTimeline* transfer, struct QueueTimeline* graphics, VkExtent3D image_granularity);
+
+// Waits for every batch and frees the staging ring
+void FreeTransferManager();
+
+// Both return a ticket for IsTransferReady. data must stay valid until
+// then. The destination is written as a whole and its previous contents are
+// not preserved, so it must not be in use by the GPU.
+uint64_t UploadBuffer(VkBuffer buffer, VkDeviceSize offset, const void* data, VkDeviceSize size);
+
+// Single mip level and layer of a 2D image, tightly packed rows of
+// texel_size bytes. texel_size must divide 16, so 3 and 12 byte formats are
+// rejected, and with a 0x0x0 granularity the image must fit in staging.
+// The image ends up in final_layout, owned by the graphics family.
+uint64_t UploadImage(
+    VkImage image,
+    VkExtent2D extent,
+    uint32_t texel_size,
+    VkImageAspectFlags aspect,
+    VkImageLayout final_layout,
+    const void* data
+);
+
+// Copies up to TRANSFER_BYTES_PER_FRAME of queued uploads to staging and
+// submits them as one batch. Never waits, when staging or every batch is
+// still in use the uploads wait for the next call.
+void PumpTransfers();
+
+// Acquire command buffers of finished batches, to be submitted on the
+// graphics queue ahead of the frame's own with wait added to the
+// submission. Call right before that submission. Returns how many were
+// written, up to MAX_TRANSFER_BATCHES. wait->timeline is NULL when there is
+// nothing to wait for.
+uint32_t TakeTransferAcquires(VkCommandBuffer* command_buffers, struct TimelineWait* wait);
+
+// The destination may be used by graphics work submitted from now on
+VkBool32 IsTransferReady(uint64_t ticket);
+
+// Pumps and submits acquires until the ticket is ready
+void WaitTransfer(uint64_t ticket);
+
+// Frees the staging ring when no upload needs it, the next upload creates
+// it again. Returns the bytes released.
+VkDeviceSize TrimTransferStaging();
+
+void GetTransferStats(struct TransferStats* stats);
+
+#endif
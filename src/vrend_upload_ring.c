@@ -0,0 +1,90 @@
+#include "vrend.h"
+#include "vrend_upload_ring.h"
+#include "vrend_deletion.h"
+
+// Largest minUniformBufferOffsetAlignment and nonCoherentAtomSize the spec allows
+#define UPLOAD_PARTITION_ALIGNMENT 256
+
+VkDeviceSize _AlignUp(VkDeviceSize value, VkDeviceSize alignment);
+
+void InitUploadRing(
+            VkDevice device,
+            struct QueueTimeline* timeline,
+            VkDeviceSize partition_size,
+            uint32_t num_partitions,
+            VkDeviceSize atom_size,
+            VkBufferUsageFlags usage,
+            struct UploadRing* ring
+){
+    memset(ring, 0, sizeof(struct UploadRing));
+    ring->device = device;
+    ring->timeline = timeline;
+    ring->atom_size = atom_size > 0 ? atom_size : 1;
+    ring->partition_size = _AlignUp(_AlignUp(partition_size, UPLOAD_PARTITION_ALIGNMENT), ring->atom_size);
+    ring->num_partitions = num_partitions;
+    ring->partition_values = calloc(num_partitions, sizeof(uint64_t));
+    ring->partition = UINT32_MAX;
+
+    // Device local host visible memory saves the GPU reading over the bus where it exists
+    VkBufferCreateInfo buffer_ci = GetBufferCI(ring->partition_size * num_partitions, usage);
+    VK_CHECK(
+        CreateGpuBuffer, &buffer_ci,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+        &ring->buffer, &ring->allocation
+    );
+    ring->coherent = (GetGpuAllocationFlags(&ring->allocation) & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT) != 0;
+}
+
+void RetireUploadRing(struct UploadRing* ring, uint64_t timeline_value){
+    QueueDeletion((struct Deletion){ .type = DELETION_BUFFER, .handle.buffer = ring->buffer }, timeline_value);
+    QueueDeletion((struct Deletion){ .type = DELETION_ALLOCATION, .handle.allocation = ring->allocation }, timeline_value);
+    free(ring->partition_values);
+    memset(ring, 0, sizeof(struct UploadRing));
+}
+
+void BeginUploadPartition(struct UploadRing* ring, uint32_t partition){
+    uint64_t value = ring->partition_values[partition];
+    if(!IsQueueTimelineComplete(ring->device, ring->timeline, value)){
+        ring->num_stalls += 1;
+        WaitQueueTimeline(ring->device, ring->timeline, value);
+    }
+    ring->partition = partition;
+    ring->head = 0;
+}
+
+VkBool32 AllocateUpload(struct UploadRing* ring, VkDeviceSize size, VkDeviceSize alignment, struct UploadAllocation* allocation){
+    VkDeviceSize offset = _AlignUp(ring->head, alignment > 0 ? alignment : 1);
+    if(ring->partition == UINT32_MAX || offset + size > ring->partition_size){
+        ring->num_overflows += 1;
+        return VK_FALSE;
+    }
+    ring->head = offset + size;
+    ring->bytes_uploaded += size;
+
+    allocation->buffer = ring->buffer;
+    allocation->offset = ring->partition_size * ring->partition + offset;
+    allocation->data = ring->allocation.mapped + allocation->offset;
+    return VK_TRUE;
+}
+
+void FinishUploadPartition(struct UploadRing* ring){
+    if(ring->partition == UINT32_MAX) return;
+
+    if(!ring->coherent && ring->head > 0){
+        VkMappedMemoryRange range = {0};
+        range.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
+        range.pNext = NULL;
+        range.memory = ring->allocation.memory;
+        range.offset = ring->allocation.offset + ring->partition_size * ring->partition;
+        range.size = _AlignUp(ring->head, ring->atom_size);
+        VK_CHECK_S(vkFlushMappedMemoryRanges, ring->device, 1, &range);
+    }
+
+    if(ring->head > ring->peak_bytes) ring->peak_bytes = ring->head;
+    ring->partition_values[ring->partition] = ring->timeline->next_value;
+    ring->partition = UINT32_MAX;
+}
+
+VkDeviceSize _AlignUp(VkDeviceSize value, VkDeviceSize alignment){
+    return (value + alignment - 1) / alignment * alignment;
+}
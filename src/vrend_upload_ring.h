@@ -0,0 +1,69 @@
+#ifndef _VREND_UPLOAD_RING_H_
+#define _VREND_UPLOAD_RING_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <vulkan/vulkan.h>
+
+#include "vrend_timeline.h"
+#include "vrend_memory.h"
+
+#define DEFAULT_UPLOAD_PARTITION_SIZE (256 * 1024)
+
+// One persistently mapped buffer split into equal partitions. A partition is
+// filled by one frame and reused only once the timeline reaches the value of
+// the submission that read it, so nothing is allocated or mapped per frame.
+struct UploadRing {
+    VkDevice                                device;
+    struct QueueTimeline*                   timeline;
+    VkBuffer                                buffer;
+    struct GpuAllocation                    allocation;
+    VkBool32                                coherent;
+    VkDeviceSize                            atom_size;              // Flushes are rounded to nonCoherentAtomSize
+    VkDeviceSize                            partition_size;
+    uint32_t                                num_partitions;
+    uint64_t*                               partition_values;       // Timeline value of the last submission reading each partition
+    uint32_t                                partition;              // Being filled, UINT32_MAX between frames
+    VkDeviceSize                            head;                   // Next free byte of the partition
+
+    VkDeviceSize                            peak_bytes;             // Most bytes used by one frame
+    uint64_t                                bytes_uploaded;
+    uint64_t                                num_overflows;          // Allocations that did not fit their partition
+    uint64_t                                num_stalls;             // Partitions still read by the GPU when begun
+};
+
+struct UploadAllocation {
+    VkBuffer                                buffer;
+    VkDeviceSize                            offset;                 // In buffer
+    void*                                   data;
+};
+
+// usage covers everything the ring is read as, e.g. uniform, vertex and
+// indirect buffers. Partitions are rounded to 256 bytes, the largest
+// minUniformBufferOffsetAlignment allowed, so each starts aligned for any use.
+void InitUploadRing(
+    VkDevice device,
+    struct QueueTimeline* timeline,
+    VkDeviceSize partition_size,
+    uint32_t num_partitions,
+    VkDeviceSize atom_size,
+    VkBufferUsageFlags usage,
+    struct UploadRing* ring
+);
+
+// Queues the buffer for deletion once the timeline reaches timeline_value
+void RetireUploadRing(struct UploadRing* ring, uint64_t timeline_value);
+
+// Waits for the last submission that read the partition, which the caller
+// normally waited for already, and starts filling it from the beginning
+void BeginUploadPartition(struct UploadRing* ring, uint32_t partition);
+
+// Returns VK_FALSE when the partition is full
+VkBool32 AllocateUpload(struct UploadRing* ring, VkDeviceSize size, VkDeviceSize alignment, struct UploadAllocation* allocation);
+
+// Makes the frame's writes visible to the device with at most one flush and
+// ties the partition to the next submission on the timeline, so call it
+// right before submitting the work that reads it
+void FinishUploadPartition(struct UploadRing* ring);
+
+#endif